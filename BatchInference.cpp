@@ -0,0 +1,113 @@
+#include "BatchInference.h"
+#include "ThreadPool.h"
+#include <algorithm>
+using namespace std;
+
+// Include가 하나도 없는 절은 예측 모드에서 항상 0이므로 목록에서 제외
+BatchInference::BatchInference(const MultipleClassTsetlin& model)
+        : num_classes(model.numClasses()) {
+    literal_words = model.machine(0).literalWords();
+    num_literals = model.machine(0).numLiterals();
+    vector<int> included;
+    class_begin.push_back(0);
+    clause_begin.push_back(0);
+    for (int c = 0; c < num_classes; c++) {
+        const TsetlinMachine& machine = model.machine(c);
+        thresholds.push_back(machine.voteThreshold());
+        for (int j = 0; j < machine.numClauses(); j++) {
+            machine.includedLiterals(j, included);
+            if (included.empty())
+                continue;
+            literals.insert(literals.end(), included.begin(), included.end());
+            clause_begin.push_back((int)literals.size());
+            clause_sign.push_back(j % 2 == 0 ? 1 : -1);
+        }
+        class_begin.push_back((int)clause_sign.size());
+    }
+}
+
+// 예제 e의 켜진 리터럴마다 literal_bits[리터럴]의 e번 비트를 켬
+void BatchInference::transpose(const unsigned int* X, size_t stride, int count,
+                               vector<uint64_t>& literal_bits) const {
+    fill(literal_bits.begin(), literal_bits.end(), 0);
+    for (int e = 0; e < count; e++) {
+        const unsigned int* Xi = X + e * stride;
+        uint64_t bit = 1ull << e;
+        for (int k = 0; k < literal_words; k++) {
+            unsigned int word = Xi[k];
+            while (word) {
+                int literal = k * INT_SIZE + __builtin_ctz(word);
+                word &= word - 1;
+                if (literal < num_literals)
+                    literal_bits[literal] |= bit;
+            }
+        }
+    }
+}
+
+// 블록들을 공용 풀에서 나눠 처리 (블록 구간마다 전치/점수 버퍼를 따로 사용)
+void BatchInference::predict(const unsigned int* X, size_t stride, int count, int* out, int* scores) const {
+    int blocks = (count + BLOCK - 1) / BLOCK;
+    ThreadPool::shared().parallelFor(0, blocks, [&](int first_block, int last_block) {
+        predict_blocks(X, stride, count, out, scores, first_block, last_block);
+    });
+}
+
+void BatchInference::predict_blocks(const unsigned int* X, size_t stride, int count, int* out, int* scores,
+                                    int first_block, int last_block) const {
+    vector<uint64_t> literal_bits(num_literals);
+    vector<int> block_scores((size_t)BLOCK * num_classes);
+    int last = min(count, last_block * BLOCK);
+    for (int first = first_block * BLOCK; first < last; first += BLOCK) {
+        int block = min(BLOCK, count - first);
+        uint64_t valid = block == 64 ? ~0ull : (1ull << block) - 1;
+        transpose(X + first * stride, stride, block, literal_bits);
+
+        for (int c = 0; c < num_classes; c++) {
+            int* class_scores = block_scores.data() + (size_t)c * BLOCK;
+            fill(class_scores, class_scores + block, 0);
+            for (int i = class_begin[c]; i < class_begin[c + 1]; i++) {
+                // 절 i의 출력 (블록의 예제별 비트): Include 리터럴 비트셋의 AND
+                uint64_t fires = valid;
+                for (int l = clause_begin[i]; l < clause_begin[i + 1] && fires; l++) {
+                    fires &= literal_bits[literals[l]];
+                }
+                while (fires) {
+                    class_scores[__builtin_ctzll(fires)] += clause_sign[i];
+                    fires &= fires - 1;
+                }
+            }
+            for (int e = 0; e < block; e++) {
+                class_scores[e] = max(-thresholds[c], min(thresholds[c], class_scores[e]));
+            }
+        }
+
+        // 점수가 가장 높은 (동점이면 앞) 클래스
+        for (int e = 0; e < block; e++) {
+            int best_class = 0;
+            int best_score = 0;
+            for (int c = 0; c < num_classes; c++) {
+                int score = block_scores[(size_t)c * BLOCK + e];
+                if (scores != nullptr)
+                    scores[(size_t)(first + e) * num_classes + c] = score;
+                if (c == 0 || score > best_score) {
+                    best_score = score;
+                    best_class = c;
+                }
+            }
+            out[first + e] = best_class;
+        }
+    }
+}
+
+double BatchInference::evaluate(const Dataset& data) const {
+    int num_examples = data.size();
+    vector<int> predicted(num_examples);
+    predict(data.data(), data.stride(), num_examples, predicted.data());
+    int errors = 0;
+    for (int i = 0; i < num_examples; i++) {
+        if (predicted[i] != data.label(i))
+            errors++;
+    }
+    return 1.0 - static_cast<double>(errors) / num_examples;
+}
@@ -0,0 +1,48 @@
+#ifndef TSETLIN_MACHINE_BATCHINFERENCE_H
+#define TSETLIN_MACHINE_BATCHINFERENCE_H
+
+#include "MultiClassTsetlin.h"
+#include "Dataset.h"
+#include <vector>
+#include <cstdint>
+using namespace std;
+
+// 예제 전치(bitsliced) 배치 추론 엔진.
+// 예제 BLOCK개를 전치하여 리터럴마다 "이 리터럴이 켜진 예제" 비트셋(uint64_t)을 만들고,
+// 절의 출력은 Include된 리터럴 비트셋들의 AND로 블록 전체에 대해 한 번에 계산.
+//  – 생성 시 모델의 Include 목록을 평평한 배열로 복사 (이후 모델이 학습되어도 반영되지 않음: 다시 생성)
+//  – 결과는 MultipleClassTsetlin::predict와 같음 (예측 모드: Include가 없는 절은 0, 클래스 점수는 ±threshold로 클립)
+class BatchInference {
+public:
+    static const int BLOCK = 64; // 한 번에 평가하는 예제 수 (비트셋 폭)
+
+    explicit BatchInference(const MultipleClassTsetlin& model);
+
+    // 예제 i는 X + i * stride (워드 단위)에서 시작. 예측 클래스를 out[i]에 기록하고,
+    // scores가 nullptr가 아니면 scores[i * numClasses() + c]에 클래스별 점수를 기록.
+    // 블록들은 공용 스레드 풀(ThreadPool::shared)에서 나눠 처리
+    void predict(const unsigned int* X, size_t stride, int count, int* out, int* scores = nullptr) const;
+    double evaluate(const Dataset& data) const;
+
+    int numClasses() const { return num_classes; }
+
+private:
+    // 내부: first_block..last_block-1번 블록의 예제를 예측
+    void predict_blocks(const unsigned int* X, size_t stride, int count, int* out, int* scores,
+                        int first_block, int last_block) const;
+    // 예제 count개(≤ BLOCK)를 전치하여 literal_bits[리터럴]에 기록
+    void transpose(const unsigned int* X, size_t stride, int count, vector<uint64_t>& literal_bits) const;
+
+    static const int INT_SIZE = sizeof(unsigned int) * 8;
+
+    int num_classes;
+    int literal_words;
+    int num_literals;
+    vector<int> thresholds;      // 클래스별 투표 임계값
+    vector<int> class_begin;     // 클래스 c의 절은 clause_begin[class_begin[c] .. class_begin[c+1])
+    vector<int> clause_begin;    // 절 i의 Include 리터럴은 literals[clause_begin[i] .. clause_begin[i+1])
+    vector<int> clause_sign;     // 짝수 절 +1, 홀수 절 -1
+    vector<int> literals;
+};
+
+#endif //TSETLIN_MACHINE_BATCHINFERENCE_H
@@ -0,0 +1,192 @@
+#ifndef TSETLIN_MACHINE_BITPLANEKERNELS_H
+#define TSETLIN_MACHINE_BITPLANEKERNELS_H
+
+#include "TsetlinMachine.h"
+#include <cstdint>
+#include <cstring>
+using namespace std;
+
+// TsetlinMachine과 FixedTsetlinMachine이 함께 쓰는 비트 평면 커널.
+// 워드 타입 W(unsigned int 또는 uint64_t)로 템플릿화되어 있어 실행 시 모양의 machine(W = unsigned int)과
+// 컴파일 타임 모양의 machine(W = Word)이 같은 절 평가, Type I 스트림, fused 피드백 코드를 사용.
+//  – 상태 배치는 [절][비트 평면][청크]: planes는 절의 0번 평면 0번 청크, 평면 간격은 청크 수
+//  – 리터럴 k는 워드 k / (W 비트 수)의 비트 k % (W 비트 수) (리틀 엔디언에서 W와 관계없이 같은 메모리 배치)
+
+// 절 하나의 모든 청크에 대한 fused 피드백의 종류 (커널의 KIND 인자)
+enum FeedbackKind { FEEDBACK_TYPE_II = 0, FEEDBACK_TYPE_I_FIRED = 1, FEEDBACK_TYPE_I_SILENT = 2 };
+
+// 32바이트 벡터 하나에 W 워드 LANES개 (GCC 벡터 확장: AVX2가 있으면 한 레지스터, 없으면 SSE2 두 개)
+template <typename W>
+struct PlaneVector {
+    typedef W type __attribute__((vector_size(32)));
+    static const int LANES = 32 / sizeof(W);
+};
+
+inline int word_popcount(unsigned int w) { return __builtin_popcount(w); }
+inline int word_popcount(unsigned long w) { return __builtin_popcountl(w); }
+inline int word_popcount(unsigned long long w) { return __builtin_popcountll(w); }
+
+// 절의 출력: include는 절의 결정 비트 평면(chunks개 워드), last_filter는 마지막 청크에서 유효한 비트.
+// 절에 Include된 리터럴이 입력에서 모두 1이면 1. predict이면 모든 리터럴이 Exclude인 절은 0으로 강제.
+// 결정 비트는 relaxed 원자 load로 읽으므로 Hogwild 학습 중에도 호출 가능
+template <typename W>
+inline bool clause_fires_planes(const W* include, const W* Xi, int chunks, W last_filter, bool predict) {
+    W any = 0;
+    for (int k = 0; k < chunks; k++) {
+        W word = __atomic_load_n(&include[k], __ATOMIC_RELAXED);
+        if (k == chunks - 1)
+            word &= last_filter;
+        if ((word & Xi[k]) != word)
+            return false;
+        any |= word;
+    }
+    return !predict || any != 0;
+}
+
+// Type I 피드백 스트림: literals개 중 서로 다른 active개를 고른 비트맵 (words개 워드).
+// 난수 r을 [0, literals) 범위로 사상 (r * literals) >> 32, 이미 고른 리터럴이면 다시 뽑음
+template <typename W>
+inline void draw_stream(W* stream, int words, int literals, int active, uint64_t& rng) {
+    const int word_bits = sizeof(W) * 8;
+    for (int k = 0; k < words; k++) {
+        stream[k] = 0;
+    }
+    while (active--) {
+        int f = (int)(((uint64_t)TsetlinMachine::nextRandom(rng) * literals) >> 32);
+        while (stream[f / word_bits] & (W(1) << (f % word_bits))) {
+            f = (int)(((uint64_t)TsetlinMachine::nextRandom(rng) * literals) >> 32);
+        }
+        stream[f / word_bits] |= W(1) << (f % word_bits);
+    }
+}
+
+// kind 피드백이 inc/dec할 automata (x = 입력, f = Type I 스트림, top = 결정 비트 평면, filter = 대상 마스크).
+// fused 커널, 미니배치 누적, 청크별 inc/dec 경로가 모두 이 규칙을 사용
+template <typename T>
+inline void feedback_masks(int kind, T x, T f, T top, T filter, T& inc, T& dec) {
+    T zero = x ^ x;
+    inc = zero;
+    dec = zero;
+    if (kind == FEEDBACK_TYPE_II) {
+        // Type II: 입력이 0이고 Exclude인 리터럴을 inc
+        inc = ~x & ~top & filter;
+    } else if (kind == FEEDBACK_TYPE_I_FIRED) {
+        // Type I, 절이 켜짐: 입력이 1이고 스트림 밖이면 inc, 입력이 0이고 스트림 안이면 dec
+        inc = x & ~f & filter;
+        dec = ~x & f & filter;
+    } else {
+        // Type I, 절이 꺼짐: 스트림 안의 리터럴을 dec
+        dec = f & filter;
+    }
+}
+
+// 레지스터에 읽어 둔 평면 w에서 상태값이 value 이상인 automata (state_at_least와 같은 비교)
+template <int BITS, typename T>
+inline void planes_at_least(const T* w, int value, T& result) {
+    T zero = w[0] ^ w[0];
+    if (value <= 0 || value >= (1 << BITS)) {
+        result = value <= 0 ? ~zero : zero;
+        return;
+    }
+    T gt = zero, eq = ~zero;
+#pragma GCC unroll 16
+    for (int b = BITS - 1; b >= 0; b--) {
+        if (value & (1 << b)) {
+            eq &= w[b];
+        } else {
+            gt |= eq & w[b];
+            eq &= ~w[b];
+        }
+    }
+    result = gt | eq;
+}
+
+// fused 피드백의 블록 하나: 워드 T 하나(W) 또는 여러 개(SIMD 벡터)를 한 번의 평면 순회로 갱신
+//  – 평면들을 레지스터로 읽고, 모든 평면이 1인 automata는 inc, 모두 0인 automata는 dec 대상에서 미리 제외 (포화 = 변화 없음)
+//  – inc와 dec 대상은 서로 겹치지 않으므로 캐리와 빌림을 같은 순회에서 XOR로 더하고 뺌
+//  – 블록 단위 일반 load/store이므로 절을 한 스레드만 갱신할 때만 사용 (Hogwild scratch는 청크별 원자 경로)
+//  – ABSORB: filter는 live 마스크이고, 이번에 inc한 automata 중 upper 이상, dec한 automata 중 lower 이하가 된 것을
+//    레지스터의 평면으로 바로 비교하여 frozen에 기록 (경계가 최댓값/최솟값이면 캐리 체인의 포화 마스크와 같음)
+template <int BITS, int KIND, bool ABSORB, typename T, typename W>
+inline void feedback_block(W* planes, int stride, const W* Xi, const W* stream,
+                           T filter, int lower, int upper, T& to_include, T& to_exclude, T& frozen) {
+    T w[BITS];
+#pragma GCC unroll 16
+    for (int b = 0; b < BITS; b++) {
+        memcpy(&w[b], planes + b * stride, sizeof(T));
+    }
+    T x, f;
+    memcpy(&x, Xi, sizeof(T));
+    memcpy(&f, stream, sizeof(T));
+    T inc, dec;
+    feedback_masks(KIND, x, f, w[BITS - 1], filter, inc, dec);
+    T ones = w[0], zeros = ~w[0];
+#pragma GCC unroll 16
+    for (int b = 1; b < BITS; b++) {
+        ones &= w[b];
+        zeros &= ~w[b];
+    }
+    T carry = inc & ~ones;
+    T borrow = dec & ~zeros;
+    T top = w[BITS - 1];
+#pragma GCC unroll 16
+    for (int b = 0; b < BITS; b++) {
+        T plane = w[b];
+        w[b] = plane ^ carry ^ borrow;
+        carry &= plane;
+        borrow &= ~plane;
+    }
+#pragma GCC unroll 16
+    for (int b = 0; b < BITS; b++) {
+        memcpy(planes + b * stride, &w[b], sizeof(T));
+    }
+    to_include = ~top & w[BITS - 1];
+    to_exclude = top & ~w[BITS - 1];
+    if (ABSORB) {
+        T at_upper, above_lower;
+        planes_at_least<BITS>(w, upper, at_upper);
+        planes_at_least<BITS>(w, lower + 1, above_lower);
+        frozen = (inc & at_upper) | (dec & ~above_lower);
+    }
+}
+
+// 절 전체(planes, 평면 간격 chunks)에 KIND 피드백을 한 번에 적용.
+// 여러 청크를 SIMD 벡터로 묶어 inc의 캐리와 dec의 빌림을 같은 평면 순회에서 계산하고, 포화는 분기 없이 미리 제외.
+// Exclude → Include로 바뀐 수를 included, Include → Exclude로 바뀐 수를 excluded에 기록
+template <int BITS, int KIND, typename W>
+void feedback_planes(W* planes, int chunks, const W* Xi, const W* stream, W last_filter,
+                     int& included, int& excluded) {
+    typedef typename PlaneVector<W>::type Vector;
+    const int lanes = PlaneVector<W>::LANES;
+    included = 0;
+    excluded = 0;
+    // 마지막 청크는 필터가 필요하므로 벡터 구간에서 제외
+    int vector_end = (chunks - 1) / lanes * lanes;
+    Vector all = ~(Vector){};
+    for (int k = 0; k < vector_end; k += lanes) {
+        Vector to_include, to_exclude, frozen;
+        feedback_block<BITS, KIND, false>(planes + k, chunks, Xi + k, stream + k, all, 0, 0,
+                                          to_include, to_exclude, frozen);
+        Vector changed = to_include | to_exclude;
+        W any = 0;
+        for (int l = 0; l < lanes; l++) {
+            any |= changed[l];
+        }
+        if (any) {
+            for (int l = 0; l < lanes; l++) {
+                included += word_popcount(to_include[l]);
+                excluded += word_popcount(to_exclude[l]);
+            }
+        }
+    }
+    for (int k = vector_end; k < chunks; k++) {
+        W to_include, to_exclude, frozen;
+        W filter = (k == chunks - 1) ? last_filter : ~W(0);
+        feedback_block<BITS, KIND, false>(planes + k, chunks, Xi + k, stream + k, filter, 0, 0,
+                                          to_include, to_exclude, frozen);
+        included += word_popcount(to_include);
+        excluded += word_popcount(to_exclude);
+    }
+}
+
+#endif //TSETLIN_MACHINE_BITPLANEKERNELS_H
@@ -0,0 +1,95 @@
+#include "BooleanEncoder.h"
+#include <cstring>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+using namespace std;
+
+namespace {
+
+// 0으로 초기화된 비트열 out의 bit 위치부터 value의 하위 nbits(≤ 32)를 OR (value의 상위 비트는 0이어야 함)
+inline void append_bits(unsigned int* out, size_t bit, unsigned int value, int nbits) {
+    size_t word = bit / 32;
+    int shift = bit % 32;
+    out[word] |= value << shift;
+    if (shift != 0 && shift + nbits > 32)
+        out[word + 1] |= value >> (32 - shift);
+}
+
+#if defined(__AVX2__)
+// 32픽셀 중 threshold 이상인 픽셀의 비트마스크 (부호 없는 비교: max(x, t) == x)
+inline unsigned int at_least_32(const uint8_t* pixels, __m256i threshold) {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pixels));
+    return (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(x, threshold), x));
+}
+#endif
+
+#if defined(__SSE2__)
+// 16픽셀 중 threshold 이상인 픽셀의 비트마스크
+inline unsigned int at_least_16(const uint8_t* pixels, __m128i threshold) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels));
+    return (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(x, threshold), x));
+}
+#endif
+
+} // namespace
+
+BooleanEncoder::BooleanEncoder(int features, const vector<uint8_t>& thresholds)
+        : features(features), thresholds(thresholds) {}
+
+BooleanEncoder BooleanEncoder::threshold(int features, uint8_t level) {
+    return BooleanEncoder(features, vector<uint8_t>(1, level));
+}
+
+BooleanEncoder BooleanEncoder::thermometer(int features, int levels) {
+    vector<uint8_t> thresholds;
+    for (int t = 0; t < levels; t++) {
+        thresholds.push_back((uint8_t)((t + 1) * 256 / (levels + 1)));
+    }
+    return BooleanEncoder(features, thresholds);
+}
+
+// 1단계: 임계값마다 픽셀을 비교하여 특성 비트를 붙임
+// 2단계: 특성 비트 워드를 반전하여 outputFeatures() 위치부터 부정 리터럴로 붙임
+void BooleanEncoder::encode(const uint8_t* row, unsigned int* out) const {
+    memset(out, 0, words() * sizeof(unsigned int));
+    for (size_t t = 0; t < thresholds.size(); t++) {
+        size_t base = t * features;
+        uint8_t level = thresholds[t];
+        int j = 0;
+#if defined(__AVX2__)
+        __m256i level_32 = _mm256_set1_epi8((char)level);
+        for (; j + 32 <= features; j += 32) {
+            append_bits(out, base + j, at_least_32(row + j, level_32), 32);
+        }
+#endif
+#if defined(__SSE2__)
+        __m128i level_16 = _mm_set1_epi8((char)level);
+        for (; j + 16 <= features; j += 16) {
+            append_bits(out, base + j, at_least_16(row + j, level_16), 16);
+        }
+#endif
+        for (; j < features; j++) {
+            if (row[j] >= level)
+                out[(base + j) / INT_SIZE] |= (1u << ((base + j) % INT_SIZE));
+        }
+    }
+
+    int n = outputFeatures();
+    for (int w = 0; w * INT_SIZE < n; w++) {
+        int bits = min(INT_SIZE, n - w * INT_SIZE);
+        unsigned int mask = bits == INT_SIZE ? ~0u : ((1u << bits) - 1);
+        append_bits(out, (size_t)n + w * INT_SIZE, ~out[w] & mask, bits);
+    }
+}
+
+bool BooleanEncoder::encode(const uint8_t* rows, size_t row_stride, int count, const int* labels,
+                            Dataset& data) const {
+    if (data.words() != words())
+        return false;
+    data.reserve(data.size() + count);
+    for (int i = 0; i < count; i++) {
+        encode(rows + i * row_stride, data.append(labels[i]));
+    }
+    return true;
+}
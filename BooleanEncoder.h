@@ -0,0 +1,43 @@
+#ifndef TSETLIN_MACHINE_BOOLEANENCODER_H
+#define TSETLIN_MACHINE_BOOLEANENCODER_H
+
+#include "Dataset.h"
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+using namespace std;
+
+// 8비트 회색조 특성 행을 Tsetlin Machine 입력(리터럴 + 부정 리터럴 비트 패킹)으로 바꾸는 인코더.
+//  – 임계값 인코딩: 픽셀 >= level 이면 1 (이미 이진화된 0/1 데이터는 level = 1)
+//  – 온도계(thermometer) 인코딩: levels개의 임계값마다 비트 하나 (픽셀이 클수록 1인 비트가 많음)
+// 출력 특성 t * features + j는 t번 임계값에 대한 j번 픽셀. 리터럴 배치는 기존 packExample과 같음
+// (특성 비트 outputFeatures()개 다음에 부정 비트 outputFeatures()개)
+// 비교는 SSE2/AVX2로 16/32픽셀씩 한 번에 수행하고 movemask 결과를 그대로 비트열에 붙임
+class BooleanEncoder {
+public:
+    // features: 행 하나의 픽셀 수, thresholds: 오름차순 임계값 (출력 특성 수 = features * 임계값 수)
+    BooleanEncoder(int features, const vector<uint8_t>& thresholds);
+
+    static BooleanEncoder threshold(int features, uint8_t level);
+    // levels개의 임계값을 0~255 구간에 고르게 배치: (t + 1) * 256 / (levels + 1)
+    static BooleanEncoder thermometer(int features, int levels);
+
+    // TsetlinMachine / MultipleClassTsetlin 생성자의 features 인자로 사용
+    int outputFeatures() const { return features * (int)thresholds.size(); }
+    // 패킹된 예제 하나의 워드 수
+    int words() const { return (2 * outputFeatures() + INT_SIZE - 1) / INT_SIZE; }
+
+    // 픽셀 행 하나를 out[0..words())에 기록
+    void encode(const uint8_t* row, unsigned int* out) const;
+    // count개의 행 (행 i는 rows + i * row_stride 바이트)을 라벨과 함께 data에 추가
+    // (data의 행 워드 수가 words()와 다르면 false)
+    bool encode(const uint8_t* rows, size_t row_stride, int count, const int* labels, Dataset& data) const;
+
+private:
+    static const int INT_SIZE = sizeof(unsigned int) * 8;
+
+    int features;
+    vector<uint8_t> thresholds;
+};
+
+#endif //TSETLIN_MACHINE_BOOLEANENCODER_H
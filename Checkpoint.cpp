@@ -0,0 +1,344 @@
+#include "Checkpoint.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+using namespace std;
+
+namespace {
+
+const char CHECKPOINT_MAGIC[4] = {'T', 'S', 'C', 'K'};
+const int CHECKPOINT_VERSION = 2;   // 2: 레코드에 진행 상태 추가
+const unsigned int RECORD_FULL = 1;
+const unsigned int RECORD_DELTA = 2;
+const unsigned int RECORD_END = 0x454E4443; // 레코드 끝 표시
+
+template <typename T>
+void put(ostream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool get(istream& in, T& value) {
+    return (bool)in.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+void put_random_state(ostream& out, const vector<uint64_t>& state) {
+    put(out, (uint64_t)state.size());
+    out.write(reinterpret_cast<const char*>(state.data()), state.size() * sizeof(uint64_t));
+}
+
+bool get_random_state(istream& in, vector<uint64_t>& state) {
+    uint64_t count;
+    if (!get(in, count) || count > (1u << 20))
+        return false;
+    state.resize(count);
+    return (bool)in.read(reinterpret_cast<char*>(state.data()), count * sizeof(uint64_t));
+}
+
+void put_progress(ostream& out, const string& progress) {
+    put(out, (uint64_t)progress.size());
+    out.write(progress.data(), progress.size());
+}
+
+bool get_progress(istream& in, string& progress) {
+    uint64_t size;
+    if (!get(in, size) || size > (1u << 20))
+        return false;
+    progress.assign(size, '\0');
+    return (bool)in.read(&progress[0], size);
+}
+
+// 레코드 하나를 [종류][epoch][길이][내용][끝 표시]로 기록
+void put_record(ostream& out, unsigned int type, int epoch, const string& payload) {
+    put(out, type);
+    put(out, epoch);
+    put(out, (uint64_t)payload.size());
+    out.write(payload.data(), payload.size());
+    put(out, RECORD_END);
+}
+
+// machine의 모든 비트 평면을 [절][청크][비트] 순서로 out에 복사
+void capture(const TsetlinMachine& machine, vector<unsigned int>& out) {
+    int bits = machine.stateBits();
+    int chunks = machine.literalWords();
+    out.resize((size_t)machine.numClauses() * chunks * bits);
+    for (int j = 0; j < machine.numClauses(); j++) {
+        for (int k = 0; k < chunks; k++) {
+            machine.getChunk(j, k, &out[((size_t)j * chunks + k) * bits]);
+        }
+    }
+}
+
+} // namespace
+
+Checkpointer::Checkpointer(const string& path, int full_every)
+        : path(path), full_every(max(1, full_every)), deltas_since_full(0),
+          has_pending(false), busy(false), stopping(false), pending_best_epoch(0),
+          failed(false), records(0), bytes(0) {
+    worker = thread(&Checkpointer::run, this);
+}
+
+Checkpointer::~Checkpointer() {
+    {
+        lock_guard<mutex> lock(mtx);
+        stopping = true;
+    }
+    changed.notify_all();
+    worker.join();
+}
+
+void Checkpointer::save(shared_ptr<MultipleClassTsetlin> snapshot, const vector<uint64_t>& random_state, int epoch,
+                        const string& progress) {
+    {
+        lock_guard<mutex> lock(mtx);
+        pending.snapshot = std::move(snapshot);
+        pending.random_state = random_state;
+        pending.epoch = epoch;
+        pending.progress = progress;
+        has_pending = true;
+    }
+    changed.notify_all();
+}
+
+void Checkpointer::saveBest(shared_ptr<MultipleClassTsetlin> best, int epoch) {
+    {
+        lock_guard<mutex> lock(mtx);
+        pending_best = std::move(best);
+        pending_best_epoch = epoch;
+    }
+    changed.notify_all();
+}
+
+void Checkpointer::wait() {
+    unique_lock<mutex> lock(mtx);
+    changed.wait(lock, [&]() { return !has_pending && !pending_best && !busy; });
+}
+
+// 작업 스레드: 대기 중인 요청을 꺼내 기록 (종료 요청이 와도 남은 요청은 기록).
+// 최고 스냅샷을 먼저 기록하므로, 레코드의 진행 상태가 가리키는 최고 스냅샷은 항상 파일에 있음
+void Checkpointer::run() {
+    unique_lock<mutex> lock(mtx);
+    while (true) {
+        changed.wait(lock, [&]() { return has_pending || pending_best || stopping; });
+        if (!has_pending && !pending_best)
+            break;
+        shared_ptr<MultipleClassTsetlin> best = std::move(pending_best);
+        int best_epoch = pending_best_epoch;
+        pending_best.reset();
+        bool has_request = has_pending;
+        Request request = std::move(pending);
+        pending = Request();
+        has_pending = false;
+        busy = true;
+        lock.unlock();
+        if (best && !write_best(*best, best_epoch))
+            failed = true;
+        if (has_request && !write(request))
+            failed = true;
+        lock.lock();
+        busy = false;
+        changed.notify_all();
+    }
+}
+
+void Checkpointer::remember(MultipleClassTsetlin& model) {
+    last.resize(model.numClasses());
+    for (int c = 0; c < model.numClasses(); c++) {
+        capture(model.machine(c), last[c]);
+    }
+}
+
+bool Checkpointer::write(const Request& request) {
+    MultipleClassTsetlin& model = *request.snapshot;
+    ostringstream payload;
+    put_random_state(payload, request.random_state);
+    put_progress(payload, request.progress);
+
+    // 증분: 클래스마다 (워드 수, 바뀐 워드 비트맵, 바뀐 워드 수, 바뀐 워드들). 워드 순서는 last와 같음.
+    // 학습 초반처럼 대부분이 바뀌어 전체 기록보다 커지면 전체 기록으로 대신함
+    bool full = last.empty() || (int)last.size() != model.numClasses() || deltas_since_full >= full_every;
+    if (!full) {
+        vector<unsigned int> current, changed_map, changed_words;
+        size_t total_words = 0;
+        for (int c = 0; c < model.numClasses() && !full; c++) {
+            capture(model.machine(c), current);
+            if (current.size() != last[c].size()) {
+                full = true;
+                break;
+            }
+            changed_map.assign((current.size() + 31) / 32, 0);
+            changed_words.clear();
+            for (size_t i = 0; i < current.size(); i++) {
+                if (current[i] != last[c][i]) {
+                    changed_map[i / 32] |= (1u << (i % 32));
+                    changed_words.push_back(current[i]);
+                }
+            }
+            put(payload, (uint64_t)current.size());
+            payload.write(reinterpret_cast<const char*>(changed_map.data()), changed_map.size() * sizeof(unsigned int));
+            put(payload, (uint64_t)changed_words.size());
+            payload.write(reinterpret_cast<const char*>(changed_words.data()), changed_words.size() * sizeof(unsigned int));
+            total_words += current.size();
+        }
+        if ((size_t)payload.tellp() >= total_words * sizeof(unsigned int))
+            full = true;
+    }
+
+    if (full) {
+        payload.str("");
+        put_random_state(payload, request.random_state);
+        put_progress(payload, request.progress);
+        if (!model.save(payload))
+            return false;
+
+        // 전체 기록: 임시 파일에 쓴 뒤 교체 (기록 도중 중단되어도 이전 파일이 남음)
+        string temporary = path + ".tmp";
+        ofstream out(temporary, ios::binary | ios::trunc);
+        out.write(CHECKPOINT_MAGIC, 4);
+        put(out, CHECKPOINT_VERSION);
+        put_record(out, RECORD_FULL, request.epoch, payload.str());
+        out.close();
+        if (!out || rename(temporary.c_str(), path.c_str()) != 0) {
+            last.clear();
+            return false;
+        }
+        deltas_since_full = 0;
+    } else {
+        ofstream out(path, ios::binary | ios::app);
+        put_record(out, RECORD_DELTA, request.epoch, payload.str());
+        out.close();
+        if (!out) {
+            last.clear(); // 파일이 기준 상태와 어긋났을 수 있으므로 다음은 전체 기록
+            return false;
+        }
+        deltas_since_full++;
+    }
+    remember(model);
+    bytes += payload.str().size();
+    records++;
+    return true;
+}
+
+// 최고 스냅샷: 임시 파일에 "TSCK", 버전, epoch, 전체 모델을 쓴 뒤 교체
+bool Checkpointer::write_best(const MultipleClassTsetlin& best, int epoch) {
+    string temporary = bestPath(path) + ".tmp";
+    ofstream out(temporary, ios::binary | ios::trunc);
+    out.write(CHECKPOINT_MAGIC, 4);
+    put(out, CHECKPOINT_VERSION);
+    put(out, epoch);
+    if (!best.save(out))
+        return false;
+    out.close();
+    return out && rename(temporary.c_str(), bestPath(path).c_str()) == 0;
+}
+
+MultipleClassTsetlin* Checkpointer::resumeBest(const string& path, int& epoch) {
+    ifstream in(bestPath(path), ios::binary);
+    if (!in)
+        return nullptr;
+    char magic[4];
+    int version = 0;
+    in.read(magic, 4);
+    if (!in || memcmp(magic, CHECKPOINT_MAGIC, 4) != 0 || !get(in, version) || version != CHECKPOINT_VERSION ||
+        !get(in, epoch))
+        return nullptr;
+    return MultipleClassTsetlin::load(in);
+}
+
+MultipleClassTsetlin* Checkpointer::resume(const string& path, int& epoch, string* progress) {
+    ifstream in(path, ios::binary);
+    if (!in)
+        return nullptr;
+    char magic[4];
+    int version = 0;
+    in.read(magic, 4);
+    // 버전 1 파일은 진행 상태 없이 읽음
+    if (!in || memcmp(magic, CHECKPOINT_MAGIC, 4) != 0 || !get(in, version) ||
+        version < 1 || version > CHECKPOINT_VERSION)
+        return nullptr;
+
+    if (progress != nullptr)
+        progress->clear();
+    MultipleClassTsetlin* model = nullptr;
+    vector<unsigned int> planes;
+    while (true) {
+        unsigned int type, end;
+        int record_epoch;
+        uint64_t size;
+        if (!get(in, type) || !get(in, record_epoch) || !get(in, size) || size > (1ull << 40))
+            break;
+        string payload(size, '\0');
+        if (!in.read(&payload[0], size) || !get(in, end) || end != RECORD_END)
+            break; // 기록 도중 중단된 마지막 레코드
+
+        istringstream record(payload);
+        vector<uint64_t> random_state;
+        string record_progress;
+        if (!get_random_state(record, random_state) || (version >= 2 && !get_progress(record, record_progress)))
+            break;
+        if (type == RECORD_FULL) {
+            MultipleClassTsetlin* loaded = MultipleClassTsetlin::load(record);
+            if (loaded == nullptr)
+                break;
+            delete model;
+            model = loaded;
+        } else if (type == RECORD_DELTA && model != nullptr) {
+            // 레코드 전체를 읽고 검사한 뒤에 적용 (손상된 레코드로 모델이 반쯤 바뀌지 않도록)
+            int num_classes = model->numClasses();
+            vector<vector<unsigned int>> changed_map(num_classes), changed_words(num_classes);
+            bool complete = true;
+            for (int c = 0; c < num_classes && complete; c++) {
+                const TsetlinMachine& machine = model->machine(c);
+                uint64_t words = 0, count = 0;
+                complete = get(record, words) &&
+                           words == (uint64_t)machine.numClauses() * machine.literalWords() * machine.stateBits();
+                if (!complete)
+                    break;
+                changed_map[c].resize((words + 31) / 32);
+                complete = record.read(reinterpret_cast<char*>(changed_map[c].data()),
+                                       changed_map[c].size() * sizeof(unsigned int)) &&
+                           get(record, count) && count <= words;
+                if (!complete)
+                    break;
+                changed_words[c].resize(count);
+                complete = (bool)record.read(reinterpret_cast<char*>(changed_words[c].data()), count * sizeof(unsigned int));
+            }
+            if (!complete)
+                break;
+            // 바뀐 워드가 속한 (절, 청크)마다 현재 평면을 읽어 고친 뒤 다시 기록
+            for (int c = 0; c < num_classes; c++) {
+                TsetlinMachine& machine = model->machine(c);
+                int bits = machine.stateBits();
+                int chunks = machine.literalWords();
+                planes.resize(bits);
+                size_t next = 0;
+                long long unit = -1;
+                for (size_t w = 0; w < changed_map[c].size(); w++) {
+                    unsigned int mask = changed_map[c][w];
+                    while (mask && next < changed_words[c].size()) {
+                        size_t index = w * 32 + __builtin_ctz(mask);
+                        mask &= mask - 1;
+                        long long index_unit = (long long)(index / bits);
+                        if (index_unit != unit) {
+                            if (unit >= 0)
+                                machine.setChunk(unit / chunks, unit % chunks, planes.data());
+                            unit = index_unit;
+                            machine.getChunk(unit / chunks, unit % chunks, planes.data());
+                        }
+                        planes[index % bits] = changed_words[c][next++];
+                    }
+                }
+                if (unit >= 0)
+                    machine.setChunk(unit / chunks, unit % chunks, planes.data());
+            }
+        } else {
+            break;
+        }
+        model->setRandomState(random_state);
+        epoch = record_epoch;
+        if (progress != nullptr)
+            *progress = record_progress;
+    }
+    return model;
+}
@@ -0,0 +1,88 @@
+#ifndef TSETLIN_MACHINE_CHECKPOINT_H
+#define TSETLIN_MACHINE_CHECKPOINT_H
+
+#include "MultiClassTsetlin.h"
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+// 비동기 증분 체크포인트: 학습 스레드는 스냅샷과 난수 상태만 넘기고 바로 돌아가며,
+// 작업 스레드가 파일에 기록.
+//  – 첫 기록(그리고 full_every번의 증분 기록마다)은 전체 모델을 임시 파일에 쓴 뒤 rename으로 교체
+//  – 그 사이에는 직전 기록 이후 비트 평면이 바뀐 (절, 청크)만 파일 끝에 덧붙임
+//  – 기록 중에 새 요청이 오면 대기 중인 요청을 새 것으로 바꿈 (증분은 항상 마지막으로 기록한 상태 기준)
+//
+// 파일 형식: "TSCK", 버전, 이어서 레코드 [종류][epoch][길이][내용][끝 표시].
+// 끝 표시까지 온전한 레코드만 resume에서 적용하므로 기록 도중 중단되어도 직전 체크포인트로 복원됨.
+// 레코드 내용은 난수 상태, 호출자의 진행 상태(조기 종료 기록 등), 전체 모델 또는 증분 순.
+// saveBest로 넘긴 최고 스냅샷은 path + ".best"에 (epoch, 전체 모델)로 따로 기록
+class Checkpointer {
+public:
+    explicit Checkpointer(const string& path, int full_every = 20);
+    ~Checkpointer(); // 대기 중인 기록까지 마친 뒤 종료
+
+    Checkpointer(const Checkpointer&) = delete;
+    Checkpointer& operator=(const Checkpointer&) = delete;
+
+    // epoch개의 epoch를 마친 시점의 스냅샷을 기록 요청. random_state는 학습 중인 모델의 randomState()
+    // (스냅샷은 난수 상태를 복사하지 않으므로 따로 넘김). snapshot은 기록 중 읽기만 함
+    // progress: 재개할 때 resume이 돌려줄 호출자의 진행 상태 (형식은 호출자가 정함)
+    void save(shared_ptr<MultipleClassTsetlin> snapshot, const vector<uint64_t>& random_state, int epoch,
+              const string& progress = string());
+    // epoch의 스냅샷이 새 최고 스냅샷이 되었을 때 기록 요청 (다음 save 레코드보다 먼저 기록됨)
+    void saveBest(shared_ptr<MultipleClassTsetlin> best, int epoch);
+    // 대기 중이거나 진행 중인 기록이 끝날 때까지 대기
+    void wait();
+
+    bool ok() const { return !failed; }
+    int written() const { return records; }
+    long long bytesWritten() const { return bytes; }
+
+    // 체크포인트 파일의 마지막 온전한 상태로 모델을 만들고 (난수 상태 포함) epoch와 진행 상태를 기록.
+    // 파일이 없거나 첫 레코드가 손상되었으면 nullptr. 진행 상태가 없는 이전 버전 파일이면 progress는 빈 문자열
+    static MultipleClassTsetlin* resume(const string& path, int& epoch, string* progress = nullptr);
+    // saveBest로 기록한 최고 스냅샷과 그 epoch (없거나 손상되었으면 nullptr)
+    static MultipleClassTsetlin* resumeBest(const string& path, int& epoch);
+    // 최고 스냅샷 파일 경로
+    static string bestPath(const string& path) { return path + ".best"; }
+
+private:
+    struct Request {
+        shared_ptr<MultipleClassTsetlin> snapshot;
+        vector<uint64_t> random_state;
+        int epoch;
+        string progress;
+    };
+
+    void run();
+    bool write(const Request& request);
+    bool write_best(const MultipleClassTsetlin& best, int epoch);
+    // 스냅샷의 모든 청크를 last에 복사 (전체 기록 뒤 증분 기준)
+    void remember(MultipleClassTsetlin& model);
+
+    string path;
+    int full_every;
+    int deltas_since_full;
+    // 마지막으로 기록한 상태: last[클래스][(절 * 청크 수 + 청크) * 비트 수 + 비트]
+    vector<vector<unsigned int>> last;
+
+    mutex mtx;
+    condition_variable changed;
+    bool has_pending;
+    bool busy;
+    bool stopping;
+    Request pending;
+    shared_ptr<MultipleClassTsetlin> pending_best; // 기록할 최고 스냅샷 (없으면 nullptr)
+    int pending_best_epoch;
+    atomic<bool> failed;
+    atomic<int> records;
+    atomic<long long> bytes;
+    thread worker;
+};
+
+#endif //TSETLIN_MACHINE_CHECKPOINT_H
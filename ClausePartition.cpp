@@ -0,0 +1,267 @@
+#include "ClausePartition.h"
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <cerrno>
+#include <cstdlib>
+using namespace std;
+
+// 절 분할: INT_SIZE(32) 단위로 나누어 각 구간이 짝수 번째 절에서 시작 → 지역 절 번호의 극성이 전체와 같음
+static void partition_range(int clauses, int workers, int worker, int& begin, int& end) {
+    int chunks = (clauses + 31) / 32;
+    begin = (int)((long long)chunks * worker / workers) * 32;
+    end = min((int)((long long)chunks * (worker + 1) / workers) * 32, clauses);
+}
+
+ClausePartitionedTsetlin::ClausePartitionedTsetlin(int num_workers, int num_classes, int clauses,
+                                                   int threshold, double s, int state_bits, int features)
+        : num_workers(max(1, min(num_workers, (clauses + 31) / 32))),
+          num_classes(num_classes), threshold(threshold), failed(false) {
+    rng = ((((uint64_t)rand() << 32) ^ (uint64_t)rand()) * 0x9E3779B97F4A7C15ULL) | 1;
+    // 다른 스레드가 있으면 fork한 작업자에서 그 스레드의 잠금이 풀리지 않을 수 있으므로 작업자를 만들지 않음
+    if (count_threads() != 1) {
+        failed = true;
+        return;
+    }
+    for (int w = 0; w < this->num_workers; w++) {
+        uint64_t seed = ((uint64_t)TsetlinMachine::nextRandom(rng) << 32) | TsetlinMachine::nextRandom(rng);
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+            failed = true;
+            return;
+        }
+        pid_t pid = fork();
+        if (pid < 0) {
+            close(fds[0]);
+            close(fds[1]);
+            failed = true;
+            return;
+        }
+        if (pid == 0) {
+            // 작업자: 이전에 만든 다른 작업자들의 소켓은 닫음
+            close(fds[0]);
+            for (int fd : sockets) {
+                close(fd);
+            }
+            worker_main(fds[1], w, this->num_workers, num_classes, clauses, threshold, s, state_bits, features, seed);
+            _exit(0);
+        }
+        close(fds[1]);
+        sockets.push_back(fds[0]);
+        workers.push_back(pid);
+    }
+}
+
+// 생성에 성공한 작업자만 멈추고 기다림 (연결이 끊긴 작업자는 STOP을 받지 못해도 소켓을 닫으면 종료)
+ClausePartitionedTsetlin::~ClausePartitionedTsetlin() {
+    Header header = {OP_STOP, 0, 0, 0};
+    for (size_t w = 0; w < sockets.size(); w++) {
+        write_all(sockets[w], &header, sizeof(header));
+        close(sockets[w]);
+        waitpid(workers[w], nullptr, 0);
+    }
+}
+
+int ClausePartitionedTsetlin::count_threads() {
+    DIR* dir = opendir("/proc/self/task");
+    if (dir == nullptr)
+        return -1;
+    int threads = 0;
+    while (dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] != '.')
+            threads++;
+    }
+    closedir(dir);
+    return threads;
+}
+
+// 상대가 연결을 닫았으면 SIGPIPE 대신 false
+bool ClausePartitionedTsetlin::write_all(int fd, const void* data, size_t bytes) {
+    const char* p = static_cast<const char*>(data);
+    while (bytes > 0) {
+        ssize_t n = send(fd, p, bytes, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        bytes -= n;
+    }
+    return true;
+}
+
+// 요청한 바이트를 모두 읽으면 true, 상대가 연결을 닫았으면 false
+bool ClausePartitionedTsetlin::read_all(int fd, void* data, size_t bytes) {
+    char* p = static_cast<char*>(data);
+    while (bytes > 0) {
+        ssize_t n = read(fd, p, bytes);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        bytes -= n;
+    }
+    return true;
+}
+
+bool ClausePartitionedTsetlin::broadcast(const Header& header, const void* payload, size_t bytes) {
+    if (failed)
+        return false;
+    for (int w = 0; w < num_workers; w++) {
+        if (!write_all(sockets[w], &header, sizeof(header)) ||
+            (bytes > 0 && !write_all(sockets[w], payload, bytes))) {
+            failed = true;
+            return false;
+        }
+    }
+    return true;
+}
+
+void ClausePartitionedTsetlin::worker_main(int fd, int worker, int num_workers, int num_classes, int clauses,
+                                           int threshold, double s, int state_bits, int features, uint64_t seed) {
+    int begin, end;
+    partition_range(clauses, num_workers, worker, begin, end);
+
+    vector<TsetlinMachine*> machines;
+    for (int i = 0; i < num_classes; i++) {
+        machines.push_back(new TsetlinMachine(end - begin, threshold, s, state_bits, features));
+        // 조정자가 작업자마다 뽑은 seed에서 클래스별로 난수 스트림을 분리
+        machines[i]->seed(seed + (uint64_t)i * 0x9E3779B97F4A7C15ULL);
+    }
+
+    int words = machines[0]->literalWords();
+    vector<unsigned int> Xi(words);
+    vector<int> votes(num_classes);
+    int train_classes[2] = {0, 0};
+
+    Header header;
+    while (read_all(fd, &header, sizeof(header))) {
+        if (header.op == OP_STOP)
+            break;
+        if (header.op == OP_VOTES || header.op == OP_PREDICT) {
+            // 예제 크기는 모델의 리터럴 워드 수와 같아야 함 (다르면 연결을 닫아 조정자에게 알림)
+            if (header.words != words)
+                break;
+            if (!read_all(fd, Xi.data(), words * sizeof(unsigned int)))
+                break;
+        }
+        if (header.op == OP_VOTES &&
+            (header.a < 0 || header.a >= num_classes || header.b < 0 || header.b >= num_classes))
+            break;
+        if (header.op == OP_VOTES) {
+            // 타깃 클래스(a)와 부정 클래스(b)의 부분 투표, 절 출력은 피드백 단계까지 유지
+            train_classes[0] = header.a;
+            train_classes[1] = header.b;
+            int partial[2];
+            partial[0] = machines[header.a]->partialVotes(Xi, false);
+            partial[1] = machines[header.b]->partialVotes(Xi, false);
+            if (!write_all(fd, partial, sizeof(partial)))
+                break;
+        } else if (header.op == OP_FEEDBACK) {
+            uint64_t cutoff[2];
+            if (!read_all(fd, cutoff, sizeof(cutoff)))
+                break;
+            machines[train_classes[0]]->applyFeedback(Xi, 1, cutoff[0]);
+            machines[train_classes[1]]->applyFeedback(Xi, 0, cutoff[1]);
+        } else if (header.op == OP_PREDICT) {
+            for (int i = 0; i < num_classes; i++) {
+                votes[i] = machines[i]->partialVotes(Xi, true);
+            }
+            if (!write_all(fd, votes.data(), num_classes * sizeof(int)))
+                break;
+        }
+    }
+
+    for (auto* machine : machines) {
+        delete machine;
+    }
+    close(fd);
+}
+
+// 조정자: 두 클래스의 부분 투표를 모아 클립한 뒤 피드백 기준값(고정소수점 확률)을 방송
+bool ClausePartitionedTsetlin::train(const vector<unsigned int>& Xi, int target_class) {
+    int negative_class = TsetlinMachine::nextRandom(rng) % (num_classes - 1);
+    if (negative_class >= target_class) {
+        negative_class++;
+    }
+
+    Header header = {OP_VOTES, target_class, negative_class, (int)Xi.size()};
+    if (!broadcast(header, Xi.data(), Xi.size() * sizeof(unsigned int)))
+        return false;
+
+    int class_sum[2] = {0, 0};
+    for (int w = 0; w < num_workers; w++) {
+        int partial[2];
+        if (!read_all(sockets[w], partial, sizeof(partial))) {
+            failed = true;
+            return false;
+        }
+        class_sum[0] += partial[0];
+        class_sum[1] += partial[1];
+    }
+
+    uint64_t cutoff[2];
+    for (int i = 0; i < 2; i++) {
+        int clipped = min(max(class_sum[i], -threshold), threshold);
+        cutoff[i] = TsetlinMachine::feedbackThreshold(clipped, i == 0 ? 1 : 0, threshold);
+    }
+    Header feedback = {OP_FEEDBACK, target_class, negative_class, 0};
+    return broadcast(feedback, cutoff, sizeof(cutoff));
+}
+
+int ClausePartitionedTsetlin::predict(const vector<unsigned int>& Xi) {
+    Header header = {OP_PREDICT, 0, 0, (int)Xi.size()};
+    if (!broadcast(header, Xi.data(), Xi.size() * sizeof(unsigned int)))
+        return -1;
+
+    vector<int> class_sum(num_classes, 0);
+    vector<int> partial(num_classes);
+    for (int w = 0; w < num_workers; w++) {
+        if (!read_all(sockets[w], partial.data(), num_classes * sizeof(int))) {
+            failed = true;
+            return -1;
+        }
+        for (int i = 0; i < num_classes; i++) {
+            class_sum[i] += partial[i];
+        }
+    }
+
+    // MultipleClassTsetlin::predict와 같이 클립된 점수로 비교 (동점이면 앞 클래스)
+    int best_class = 0;
+    int best_score = min(max(class_sum[0], -threshold), threshold);
+    for (int i = 1; i < num_classes; i++) {
+        int score = min(max(class_sum[i], -threshold), threshold);
+        if (score > best_score) {
+            best_score = score;
+            best_class = i;
+        }
+    }
+    return best_class;
+}
+
+double ClausePartitionedTsetlin::evaluate(const vector<vector<unsigned int>>& X, const vector<int>& y) {
+    int errors = 0;
+    int num_examples = X.size();
+    for (int i = 0; i < num_examples; i++) {
+        int predicted = predict(X[i]);
+        if (predicted < 0)
+            return -1.0;
+        if (predicted != y[i]) {
+            errors++;
+        }
+    }
+    return 1.0 - static_cast<double>(errors) / num_examples;
+}
+
+bool ClausePartitionedTsetlin::fit(const vector<vector<unsigned int>>& X, const vector<int>& y, int epochs) {
+    int num_examples = X.size();
+    for (int epoch = 0; epoch < epochs; epoch++) {
+        for (int i = 0; i < num_examples; i++) {
+            if (!train(X[i], y[i]))
+                return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,77 @@
+#ifndef TSETLIN_MACHINE_CLAUSEPARTITION_H
+#define TSETLIN_MACHINE_CLAUSEPARTITION_H
+
+#include "TsetlinMachine.h"
+#include <vector>
+#include <cstdint>
+#include <sys/types.h>
+using namespace std;
+
+// 절 분할 모델 병렬 학습: 각 클래스의 절들을 num_workers개의 연속 구간으로 나누어
+// fork()한 작업자 프로세스들이 자기 구간의 ta_state만 보유.
+// 조정자(이 객체를 만든 프로세스)와 작업자는 UNIX 도메인 소켓(socketpair)으로 통신:
+//  1) 조정자 → 작업자: 예제 Xi와 갱신할 클래스들 (VOTES)
+//  2) 작업자 → 조정자: 자기 구간의 투표 합 (클립 전)
+//  3) 조정자: 투표를 합산하여 클립, 피드백 기준값 계산 → 작업자: 기준값 (FEEDBACK)
+//  4) 작업자: 자기 구간에 피드백 적용
+// 한 리눅스 머신의 여러 프로세스로 여러 노드를 대신하는 구성.
+//  – fork()는 호출 스레드만 복제하므로 다른 스레드가 잡고 있던 잠금(할당자, iostream 등)이 작업자에서 영원히 잠긴 채 남음.
+//    따라서 ThreadPool::shared(), DataLoader, Checkpointer 등 어떤 스레드도 만들기 전에 생성해야 하며,
+//    생성 시점에 프로세스의 스레드가 둘 이상이거나 확인할 수 없으면 작업자를 만들지 않고 ok()가 false
+//  – 오류는 종료 대신 반환값으로 알림: 생성 실패나 작업자 연결 끊김 뒤에는 ok()가 false이고 모든 호출이 실패를 반환
+//  – 부정 클래스 선택과 작업자 machine들의 seed는 rand()로 seed한 조정자의 난수 상태에서 뽑음 (srand로 재현 가능)
+class ClausePartitionedTsetlin {
+public:
+    // state_bits, features: 작업자 machine들의 비트 평면 수와 입력 특성 수 (TsetlinMachine 참고)
+    ClausePartitionedTsetlin(int num_workers, int num_classes, int clauses, int threshold, double s,
+                             int state_bits = 8, int features = 784);
+    ~ClausePartitionedTsetlin();
+
+    // 모든 작업자가 생성되었고 지금까지 통신 오류가 없었는지
+    bool ok() const { return !failed; }
+
+    ClausePartitionedTsetlin(const ClausePartitionedTsetlin&) = delete;
+    ClausePartitionedTsetlin& operator=(const ClausePartitionedTsetlin&) = delete;
+
+    // MultipleClassTsetlin::train과 같은 One-vs-All 학습 (타깃 클래스 + 임의의 부정 클래스). 통신 오류면 false
+    bool train(const vector<unsigned int>& Xi, int target_class);
+    // 모든 작업자의 부분 투표를 합산하여 가장 높은 점수의 클래스를 반환 (통신 오류면 -1)
+    int predict(const vector<unsigned int>& Xi);
+    // 정확도 (통신 오류면 -1)
+    double evaluate(const vector<vector<unsigned int>>& X, const vector<int>& y);
+    bool fit(const vector<vector<unsigned int>>& X, const vector<int>& y, int epochs);
+
+private:
+    enum Op { OP_VOTES = 1, OP_FEEDBACK = 2, OP_PREDICT = 3, OP_STOP = 4 };
+
+    // 소켓 메시지 머리: 명령, 두 개의 인자 (클래스 번호), 뒤따르는 예제의 워드 수
+    struct Header {
+        int op;
+        int a;
+        int b;
+        int words;
+    };
+
+    int num_workers;
+    int num_classes;
+    int threshold;
+    uint64_t rng;          // 부정 클래스와 작업자 seed를 뽑는 난수 상태
+    bool failed;           // 생성 실패 또는 통신 오류 (이후 모든 호출이 실패)
+    vector<int> sockets;   // 작업자별 조정자 쪽 소켓 (생성에 성공한 작업자만)
+    vector<pid_t> workers; // 작업자 프로세스 id
+
+    // 작업자 프로세스 본체: 자기 절 구간의 machine들을 만들고 명령을 처리.
+    // 머리의 클래스 번호나 워드 수가 모델과 맞지 않으면 연결을 닫고 종료
+    static void worker_main(int fd, int worker, int num_workers, int num_classes, int clauses,
+                            int threshold, double s, int state_bits, int features, uint64_t seed);
+
+    // 모든 작업자에게 보냄. 하나라도 실패하면 failed를 켜고 false
+    bool broadcast(const Header& header, const void* payload, size_t bytes);
+    // 요청한 바이트를 모두 보내거나 읽으면 true, 상대가 연결을 닫았거나 오류이면 false
+    static bool write_all(int fd, const void* data, size_t bytes);
+    static bool read_all(int fd, void* data, size_t bytes);
+    // 현재 프로세스의 스레드 수 (/proc/self/task, 알 수 없으면 -1)
+    static int count_threads();
+};
+
+#endif //TSETLIN_MACHINE_CLAUSEPARTITION_H
@@ -0,0 +1,115 @@
+#include "DataLoader.h"
+#include <algorithm>
+using namespace std;
+
+DataLoader::DataLoader(const Dataset& data, int batch_size, int epochs, uint64_t seed, int depth)
+        : data(data), batch_size(max(1, batch_size)), epochs(max(0, epochs)), rng(seed * 0x9E3779B97F4A7C15ULL + 1),
+          produced(0), consumed(0), holding(false), finished_epochs(0), stopping(false),
+          producer_waiting(false), consumer_waiting(false) {
+    for (int i = 0; i < max(2, depth); i++) {
+        slots.emplace_back(data.words());
+        slots.back().batch.reserve(this->batch_size);
+    }
+    worker = thread(&DataLoader::produce, this);
+}
+
+DataLoader::~DataLoader() {
+    stopping = true;
+    {
+        lock_guard<mutex> lock(mtx);
+        changed.notify_all();
+    }
+    worker.join();
+}
+
+bool DataLoader::wait_for_free_slot() {
+    auto free = [this]() { return produced.load() - consumed.load() < slots.size(); };
+    if (!free()) {
+        unique_lock<mutex> lock(mtx);
+        producer_waiting = true;
+        changed.wait(lock, [&]() { return free() || stopping.load(); });
+        producer_waiting = false;
+    }
+    return !stopping.load();
+}
+
+void DataLoader::publish() {
+    produced.fetch_add(1);
+    if (consumer_waiting.load()) {
+        lock_guard<mutex> lock(mtx);
+        changed.notify_all();
+    }
+}
+
+void DataLoader::release() {
+    consumed.fetch_add(1);
+    if (producer_waiting.load()) {
+        lock_guard<mutex> lock(mtx);
+        changed.notify_all();
+    }
+}
+
+// epoch마다 Fisher-Yates로 순열을 섞고, 앞으로 읽을 행을 미리 prefetch하면서 배치 버퍼에 모음.
+// epoch가 끝날 때마다 빈 슬롯으로 경계를 표시
+void DataLoader::produce() {
+    static const int PREFETCH_DISTANCE = 8;
+    size_t num_examples = data.size();
+    vector<unsigned int> order(num_examples);
+    for (size_t i = 0; i < num_examples; i++) {
+        order[i] = (unsigned int)i;
+    }
+    for (int epoch = 0; epoch < epochs; epoch++) {
+        for (size_t i = num_examples; i > 1; i--) {
+            rng ^= rng >> 12;
+            rng ^= rng << 25;
+            rng ^= rng >> 27;
+            size_t j = (size_t)((rng * 2685821657736338717ULL) % i);
+            swap(order[i - 1], order[j]);
+        }
+        for (size_t first = 0; first < num_examples; first += batch_size) {
+            if (!wait_for_free_slot())
+                return;
+            Slot& slot = slots[produced.load(memory_order_relaxed) % slots.size()];
+            slot.batch.clear();
+            size_t last = min(num_examples, first + batch_size);
+            for (size_t i = first; i < last; i++) {
+                if (i + PREFETCH_DISTANCE < last)
+                    __builtin_prefetch(data.row(order[i + PREFETCH_DISTANCE]));
+                slot.batch.add(data.row(order[i]), data.label(order[i]));
+            }
+            slot.end_of_epoch = false;
+            publish();
+        }
+        if (!wait_for_free_slot())
+            return;
+        Slot& slot = slots[produced.load(memory_order_relaxed) % slots.size()];
+        slot.batch.clear();
+        slot.end_of_epoch = true;
+        publish();
+    }
+}
+
+const Dataset* DataLoader::next() {
+    if (holding) {
+        holding = false;
+        release();
+    }
+    if (done())
+        return nullptr;
+    size_t index = consumed.load(memory_order_relaxed);
+    if (produced.load() == index) {
+        unique_lock<mutex> lock(mtx);
+        consumer_waiting = true;
+        changed.wait(lock, [&]() { return produced.load() != index; });
+        consumer_waiting = false;
+    }
+    Slot& slot = slots[index % slots.size()];
+    if (slot.end_of_epoch) {
+        // 경계 슬롯은 바로 반납
+        finished_epochs++;
+        release();
+        return nullptr;
+    }
+    holding = true;
+    return &slot.batch;
+}
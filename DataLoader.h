@@ -0,0 +1,72 @@
+#ifndef TSETLIN_MACHINE_DATALOADER_H
+#define TSETLIN_MACHINE_DATALOADER_H
+
+#include "Dataset.h"
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <cstdint>
+using namespace std;
+
+// 백그라운드 셔플링 로더: 작업 스레드가 epoch마다 새 순열을 만들고, 순열 순서대로 예제를 모아
+// batch_size개씩 연속 버퍼(Dataset)에 복사해 둠. 학습 스레드는 next()로 다 채워진 배치를 받아
+// 순서대로 읽기만 하므로 무작위 접근의 캐시 미스를 작업 스레드가 대신 부담.
+//  – 배치 버퍼 depth개를 원형으로 재사용하는 단일 생산자/단일 소비자 큐 (원자 인덱스 2개, 평소에는 잠금 없음).
+//    큐가 비거나 가득 찬 쪽만 mutex를 잡고 condition variable로 잠들며, 상대편은 잠든 쪽이 있을 때만 깨움
+//  – 학습 전체에서 로더 하나를 쓰면 epoch 경계에서도 작업 스레드가 다음 epoch의 배치를 미리 준비함
+//  – next()는 한 번에 한 스레드에서만 호출 (epoch마다 다른 스레드가 이어받는 것은 괜찮음)
+class DataLoader {
+public:
+    // data는 로더보다 오래 살아 있어야 함. epochs번 순열을 돌면 끝
+    DataLoader(const Dataset& data, int batch_size, int epochs, uint64_t seed, int depth = 4);
+    ~DataLoader();
+
+    DataLoader(const DataLoader&) = delete;
+    DataLoader& operator=(const DataLoader&) = delete;
+
+    // 현재 epoch의 다음 배치 (다음 next() 호출 전까지 유효, 이전 배치는 이때 반납).
+    // epoch가 끝나면 nullptr를 한 번 반환하고, 다음 호출부터는 다음 epoch의 배치.
+    // 모든 epoch가 끝난 뒤에는 계속 nullptr
+    const Dataset* next();
+    // 모든 epoch를 다 읽었는지
+    bool done() const { return finished_epochs >= epochs; }
+
+private:
+    struct Slot {
+        Dataset batch;
+        bool end_of_epoch; // epoch가 끝났음을 알리는 빈 슬롯
+        explicit Slot(int words) : batch(words), end_of_epoch(false) {}
+    };
+
+    void produce();
+    // 생산자: 빈 슬롯이 생길 때까지 대기 (중단되면 false)
+    bool wait_for_free_slot();
+    // 슬롯 하나를 채웠음을 알림 (소비자가 잠들어 있을 때만 깨움)
+    void publish();
+    // 소비자: 현재 슬롯을 반납 (생산자가 잠들어 있을 때만 깨움)
+    void release();
+
+    const Dataset& data;
+    int batch_size;
+    int epochs;
+    uint64_t rng;
+    vector<Slot> slots;
+
+    // 생산자가 채운 슬롯 수 / 소비자가 반납한 슬롯 수 (서로 다른 캐시 라인)
+    alignas(64) atomic<size_t> produced;
+    alignas(64) atomic<size_t> consumed;
+    bool holding;           // 소비자가 슬롯 하나를 들고 있는지
+    int finished_epochs;    // 소비자가 끝을 확인한 epoch 수
+    atomic<bool> stopping;
+    // 잠들기: mtx를 잡고 자기 waiting을 켠 뒤 조건을 다시 확인하고 대기.
+    // 깨우기: 인덱스를 바꾼 뒤 상대의 waiting이 켜져 있을 때만 mtx를 잡고 알림 (모두 seq_cst라 알림을 놓치지 않음)
+    atomic<bool> producer_waiting;
+    atomic<bool> consumer_waiting;
+    mutex mtx;
+    condition_variable changed;
+    thread worker;
+};
+
+#endif //TSETLIN_MACHINE_DATALOADER_H
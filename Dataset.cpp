@@ -0,0 +1,73 @@
+#include "Dataset.h"
+#include <cstdlib>
+#include <cstring>
+#include <new>
+using namespace std;
+
+Dataset::Dataset(int words)
+        : row_words(words), count(0), capacity(0), buffer(nullptr) {
+    // 행 간격을 ALIGNMENT 바이트 배수로 올림 (채워 넣은 워드는 0)
+    const size_t words_per_line = ALIGNMENT / sizeof(unsigned int);
+    row_stride = (words + words_per_line - 1) / words_per_line * words_per_line;
+}
+
+Dataset::~Dataset() {
+    free(buffer);
+}
+
+Dataset::Dataset(Dataset&& other) noexcept
+        : row_words(other.row_words), row_stride(other.row_stride), count(other.count),
+          capacity(other.capacity), buffer(other.buffer), labels_(std::move(other.labels_)) {
+    other.buffer = nullptr;
+    other.count = other.capacity = 0;
+}
+
+Dataset& Dataset::operator=(Dataset&& other) noexcept {
+    if (this != &other) {
+        free(buffer);
+        row_words = other.row_words;
+        row_stride = other.row_stride;
+        count = other.count;
+        capacity = other.capacity;
+        buffer = other.buffer;
+        labels_ = std::move(other.labels_);
+        other.buffer = nullptr;
+        other.count = other.capacity = 0;
+    }
+    return *this;
+}
+
+void Dataset::reserve(size_t new_capacity) {
+    if (new_capacity <= capacity)
+        return;
+    size_t bytes = new_capacity * row_stride * sizeof(unsigned int);
+    // aligned_alloc은 크기가 정렬 단위의 배수여야 함 (행 간격이 이미 배수)
+    unsigned int* grown = static_cast<unsigned int*>(aligned_alloc(ALIGNMENT, bytes > 0 ? bytes : ALIGNMENT));
+    if (grown == nullptr)
+        throw bad_alloc();
+    if (count > 0)
+        memcpy(grown, buffer, count * row_stride * sizeof(unsigned int));
+    free(buffer);
+    buffer = grown;
+    capacity = new_capacity;
+    labels_.reserve(new_capacity);
+}
+
+void Dataset::add(const unsigned int* Xi, int label) {
+    memcpy(append(label), Xi, row_words * sizeof(unsigned int));
+}
+
+unsigned int* Dataset::append(int label) {
+    if (count == capacity)
+        reserve(capacity == 0 ? 1024 : capacity * 2);
+    unsigned int* destination = row(count);
+    memset(destination, 0, row_stride * sizeof(unsigned int));
+    labels_.push_back(label);
+    count++;
+    return destination;
+}
+
+void Dataset::clear() {
+    count = 0;
+    labels_.clear();
+}
@@ -0,0 +1,55 @@
+#ifndef TSETLIN_MACHINE_DATASET_H
+#define TSETLIN_MACHINE_DATASET_H
+
+#include <vector>
+#include <cstddef>
+using namespace std;
+
+// 패킹된 예제들을 하나의 연속 버퍼에 저장하는 데이터셋.
+//  – 예제 i는 row(i)에서 시작하는 words()개의 워드 (행 간격 stride()는 SIMD 폭에 맞춰 올림)
+//  – 버퍼 시작 주소와 모든 행이 ALIGNMENT 바이트 경계에 정렬되어 순서대로 읽으면 하드웨어 prefetch가 잘 동작
+//  – 배치 API에는 (data(), stride(), size()) 또는 (row(first), stride(), count)로 넘김
+class Dataset {
+public:
+    static const size_t ALIGNMENT = 64; // 바이트 (캐시 라인, AVX-512 폭)
+
+    // words: 예제 하나의 워드 수 (예: 2*784 리터럴 → 49)
+    explicit Dataset(int words);
+    ~Dataset();
+
+    Dataset(const Dataset&) = delete;
+    Dataset& operator=(const Dataset&) = delete;
+    Dataset(Dataset&& other) noexcept;
+    Dataset& operator=(Dataset&& other) noexcept;
+
+    // 예제 하나 추가 (Xi는 words()개의 워드). 버퍼가 부족하면 두 배로 늘림
+    void add(const unsigned int* Xi, int label);
+    void add(const vector<unsigned int>& Xi, int label) { add(Xi.data(), label); }
+    // 0으로 채운 새 행을 추가하고 그 시작 주소를 반환 (인코더가 복사 없이 직접 기록, 다음 추가 전까지 유효)
+    unsigned int* append(int label);
+    // count개의 예제를 담을 공간을 미리 확보
+    void reserve(size_t count);
+    void clear();
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    int words() const { return row_words; }
+    // 행 간격 (워드 단위)
+    size_t stride() const { return row_stride; }
+
+    const unsigned int* data() const { return buffer; }
+    const unsigned int* row(size_t i) const { return buffer + i * row_stride; }
+    unsigned int* row(size_t i) { return buffer + i * row_stride; }
+    int label(size_t i) const { return labels_[i]; }
+    const int* labels() const { return labels_.data(); }
+
+private:
+    int row_words;
+    size_t row_stride;
+    size_t count;
+    size_t capacity;
+    unsigned int* buffer; // ALIGNMENT 정렬, capacity * row_stride 워드
+    vector<int> labels_;
+};
+
+#endif //TSETLIN_MACHINE_DATASET_H
@@ -0,0 +1,72 @@
+#ifndef TSETLIN_MACHINE_EARLYSTOPPING_H
+#define TSETLIN_MACHINE_EARLYSTOPPING_H
+
+#include <istream>
+#include <ostream>
+using namespace std;
+
+// 조기 종료 정책: epoch마다 검증 정확도와 모델 변화량(churn)을 기록하여 학습을 멈출 시점을 판단.
+//  – patience epoch 동안 최고 정확도가 min_delta보다 크게 개선되지 않으면 중단
+//  – max_churn > 0이면, epoch 동안 결정 비트가 바뀐 automata의 비율이 max_churn 이하일 때 수렴으로 보고 중단
+//    (Include 마스크가 거의 바뀌지 않으면 예측도 바뀌지 않으므로 검증 없이도 싸게 판단 가능)
+class EarlyStopping {
+public:
+    explicit EarlyStopping(int patience, double min_delta = 0.0, double max_churn = 0.0)
+            : patience(patience), min_delta(min_delta), max_churn(max_churn),
+              epochs(0), best_epoch(-1), best_accuracy(0.0), converged(false) {}
+
+    // epoch 하나의 결과 기록. 최고 정확도를 갱신했으면 true (호출자는 이때 스냅샷을 보관)
+    bool record(double accuracy, double churn) {
+        epochs++;
+        if (max_churn > 0.0 && churn <= max_churn)
+            converged = true;
+        if (best_epoch < 0 || accuracy > best_accuracy + min_delta) {
+            best_accuracy = accuracy;
+            best_epoch = epochs - 1;
+            return true;
+        }
+        return false;
+    }
+
+    bool shouldStop() const { return converged || epochs - 1 - best_epoch >= patience; }
+    // 중단 사유가 변화량 수렴인지 (아니면 patience 소진)
+    bool hasConverged() const { return converged; }
+    int bestEpoch() const { return best_epoch; }
+    double bestAccuracy() const { return best_accuracy; }
+
+    // 체크포인트용: 지금까지의 기록(epoch 수, 최고 epoch와 정확도, 수렴 여부)을 저장하고 복원.
+    // patience 등 설정은 저장하지 않음. load는 형식이 맞지 않으면 아무것도 바꾸지 않고 false
+    void save(ostream& out) const {
+        int flag = converged ? 1 : 0;
+        out.write(reinterpret_cast<const char*>(&epochs), sizeof(epochs));
+        out.write(reinterpret_cast<const char*>(&best_epoch), sizeof(best_epoch));
+        out.write(reinterpret_cast<const char*>(&best_accuracy), sizeof(best_accuracy));
+        out.write(reinterpret_cast<const char*>(&flag), sizeof(flag));
+    }
+    bool load(istream& in) {
+        int saved_epochs, saved_best_epoch, flag;
+        double saved_best_accuracy;
+        in.read(reinterpret_cast<char*>(&saved_epochs), sizeof(saved_epochs));
+        in.read(reinterpret_cast<char*>(&saved_best_epoch), sizeof(saved_best_epoch));
+        in.read(reinterpret_cast<char*>(&saved_best_accuracy), sizeof(saved_best_accuracy));
+        in.read(reinterpret_cast<char*>(&flag), sizeof(flag));
+        if (!in || saved_epochs < 0 || saved_best_epoch < -1 || saved_best_epoch >= saved_epochs)
+            return false;
+        epochs = saved_epochs;
+        best_epoch = saved_best_epoch;
+        best_accuracy = saved_best_accuracy;
+        converged = flag != 0;
+        return true;
+    }
+
+private:
+    int patience;
+    double min_delta;
+    double max_churn;
+    int epochs;
+    int best_epoch;
+    double best_accuracy;
+    bool converged;
+};
+
+#endif //TSETLIN_MACHINE_EARLYSTOPPING_H
@@ -0,0 +1,265 @@
+#ifndef TSETLIN_MACHINE_FIXEDTSETLINMACHINE_H
+#define TSETLIN_MACHINE_FIXEDTSETLINMACHINE_H
+
+#include "TsetlinMachine.h"
+#include "MultiClassTsetlin.h"
+#include "BitPlaneKernels.h"
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <type_traits>
+using namespace std;
+
+// 모양이 고정된 모델용 컴파일 타임 특수화 machine.
+// 특성 수, 절 수, 청크 워드 타입(Word), 비트 평면 수가 모두 템플릿 인자이므로 모든 루프 경계와 마스크가 constexpr이고,
+// 컴파일러가 절 평가와 캐리 체인을 완전히 펼칠 수 있음. 모양이 실행 시에 정해지면 TsetlinMachine을 그대로 사용.
+//  – Word: uint32_t 또는 uint64_t. 리터럴 k는 워드 k / (Word 비트 수)의 비트 k % (Word 비트 수)
+//  – 상태 배치는 TsetlinMachine과 같은 [절][비트 평면][청크], fromMachine/toMachine으로 서로 변환
+//  – 절 평가, Type I 스트림, fused 피드백은 TsetlinMachine과 같은 BitPlaneKernels.h 커널 (Word = uint32_t이면
+//    같은 난수 상태에서 TsetlinMachine::update와 같은 결과). 결정 비트 변화 수, 절별 Include 수, dirty 절도 같은 방식으로 기록
+//  – 흡수 상태, 리터럴 예산, 절 샤딩은 없음 (고정 모양 추론과 단일 스레드 학습용)
+template <int Features, int Clauses, typename Word = uint64_t, int StateBits = 8>
+class FixedTsetlinMachine {
+    static_assert(is_unsigned<Word>::value && sizeof(Word) % sizeof(unsigned int) == 0 && sizeof(Word) <= 8,
+                  "Word는 uint32_t 또는 uint64_t");
+    static_assert(Features > 0 && Clauses > 0, "특성 수와 절 수는 양수");
+    static_assert(StateBits >= TsetlinMachine::MIN_STATE_BITS && StateBits <= TsetlinMachine::MAX_STATE_BITS,
+                  "비트 평면 수는 TsetlinMachine과 같은 범위");
+
+public:
+    static constexpr int WORD_BITS = sizeof(Word) * 8;
+    static constexpr int LITERALS = 2 * Features;
+    static constexpr int LA_CHUNKS = (LITERALS + WORD_BITS - 1) / WORD_BITS;
+    // 마지막 청크에서 유효한 비트 마스크
+    static constexpr Word LAST_CHUNK_FILTER =
+            (LITERALS % WORD_BITS == 0) ? ~Word(0) : (Word(1) << (LITERALS % WORD_BITS)) - 1;
+    // Word 하나에 들어가는 TsetlinMachine 청크(unsigned int) 수
+    static constexpr int RATIO = sizeof(Word) / sizeof(unsigned int);
+
+    FixedTsetlinMachine(int threshold, double s)
+            : threshold(threshold), s(s),
+              stream_literals(min(max((int)round(LITERALS / s), 0), LITERALS)),
+              ta_state((size_t)Clauses * StateBits * LA_CHUNKS, 0), include_count(Clauses, 0), decision_flips(0),
+              dirty_clauses(CLAUSE_WORDS, 0) {
+        // 초기: 하위 비트 평면은 모두 1, 결정 비트는 0 → Exclude 상태 (TsetlinMachine과 같음)
+        for (int j = 0; j < Clauses; j++) {
+            for (int b = 0; b < StateBits - 1; b++) {
+                for (int k = 0; k < LA_CHUNKS; k++) {
+                    plane(j, b, k) = ~Word(0);
+                }
+            }
+        }
+    }
+
+    // 같은 모양(특성 수, 절 수, 비트 평면 수)의 TsetlinMachine 상태를 복사 (모양이 다르면 nullptr)
+    static FixedTsetlinMachine* fromMachine(const TsetlinMachine& machine) {
+        if (machine.numFeatures() != Features || machine.numClauses() != Clauses || machine.stateBits() != StateBits)
+            return nullptr;
+        FixedTsetlinMachine* fixed = new FixedTsetlinMachine(machine.voteThreshold(), machine.specificity());
+        unsigned int planes[StateBits];
+        for (int j = 0; j < Clauses; j++) {
+            for (int c = 0; c < machine.literalWords(); c++) {
+                machine.getChunk(j, c, planes);
+                for (int b = 0; b < StateBits; b++) {
+                    Word& word = fixed->plane(j, b, c / RATIO);
+                    int shift = (c % RATIO) * 32;
+                    word = (word & ~(Word(0xffffffffu) << shift)) | (Word(planes[b]) << shift);
+                }
+            }
+            fixed->include_count[j] = machine.includeCount(j);
+        }
+        return fixed;
+    }
+
+    // 같은 상태의 TsetlinMachine 생성 (호출자가 소유)
+    TsetlinMachine* toMachine() const {
+        TsetlinMachine* machine = new TsetlinMachine(Clauses, threshold, s, StateBits, Features);
+        unsigned int planes[StateBits];
+        for (int j = 0; j < Clauses; j++) {
+            for (int c = 0; c < machine->literalWords(); c++) {
+                for (int b = 0; b < StateBits; b++) {
+                    planes[b] = (unsigned int)(plane(j, b, c / RATIO) >> ((c % RATIO) * 32));
+                }
+                machine->setChunk(j, c, planes);
+            }
+        }
+        return machine;
+    }
+
+    // TsetlinMachine 입력 형식(unsigned int 워드, literalWords()개)을 Word 워드 LA_CHUNKS개로 변환
+    static void packInput(const unsigned int* Xi, Word* out) {
+        constexpr int words = (LITERALS + 31) / 32;
+        for (int k = 0; k < LA_CHUNKS; k++) {
+            Word word = 0;
+            for (int r = 0; r < RATIO && k * RATIO + r < words; r++) {
+                word |= Word(Xi[k * RATIO + r]) << (r * 32);
+            }
+            out[k] = word;
+        }
+    }
+
+    // 절 j의 출력 (predict 모드에서는 모든 리터럴이 Exclude인 절이 0)
+    bool clauseFires(const Word* Xi, int j, bool predict = true) const {
+        return clause_fires_planes(&plane(j, StateBits - 1, 0), Xi, LA_CHUNKS, LAST_CHUNK_FILTER, predict);
+    }
+
+    // 클립된 투표 합 (짝수 절 +, 홀수 절 -). 상태에 쓰지 않으므로 여러 스레드에서 동시에 호출 가능
+    int score(const Word* Xi) const {
+        int class_sum = 0;
+        for (int j = 0; j < Clauses; j++) {
+            if (clauseFires(Xi, j))
+                class_sum += 1 - 2 * (j & 1);
+        }
+        return min(max(class_sum, -threshold), threshold);
+    }
+
+    // 온라인 학습: TsetlinMachine::update와 같은 Type I / Type II 피드백 (난수 상태는 호출자가 제공).
+    // 난수도 같은 순서로 사용: 모든 절의 피드백 여부를 먼저 뽑고, Type I 피드백을 받는 절마다 스트림 하나
+    void update(const Word* Xi, int target, uint64_t& rng) {
+        bool fired[Clauses];
+        int class_sum = 0;
+        for (int j = 0; j < Clauses; j++) {
+            fired[j] = clauseFires(Xi, j, false);
+            if (fired[j])
+                class_sum += 1 - 2 * (j & 1);
+        }
+        class_sum = min(max(class_sum, -threshold), threshold);
+        uint64_t cutoff = TsetlinMachine::feedbackThreshold(class_sum, target, threshold);
+        bool feedback[Clauses];
+        for (int j = 0; j < Clauses; j++) {
+            feedback[j] = (uint64_t)TsetlinMachine::nextRandom(rng) < cutoff;
+        }
+
+        Word stream[LA_CHUNKS] = {};
+        for (int j = 0; j < Clauses; j++) {
+            if (!feedback[j])
+                continue;
+            int feedback_type = (2 * target - 1) * (1 - 2 * (j & 1));
+            int included, excluded;
+            if (feedback_type == -1) {
+                // Type II: 켜진 절에서 입력이 0이고 Exclude인 리터럴을 inc
+                if (!fired[j])
+                    continue;
+                feedback_planes<StateBits, FEEDBACK_TYPE_II>(&plane(j, 0, 0), LA_CHUNKS, Xi, stream,
+                                                             LAST_CHUNK_FILTER, included, excluded);
+            } else {
+                // Type I: 리터럴의 약 1/s를 고른 스트림으로 inc/dec
+                draw_stream(stream, LA_CHUNKS, LITERALS, stream_literals, rng);
+                if (fired[j])
+                    feedback_planes<StateBits, FEEDBACK_TYPE_I_FIRED>(&plane(j, 0, 0), LA_CHUNKS, Xi, stream,
+                                                                      LAST_CHUNK_FILTER, included, excluded);
+                else
+                    feedback_planes<StateBits, FEEDBACK_TYPE_I_SILENT>(&plane(j, 0, 0), LA_CHUNKS, Xi, stream,
+                                                                       LAST_CHUNK_FILTER, included, excluded);
+            }
+            if (included + excluded > 0) {
+                include_count[j] += included - excluded;
+                decision_flips += included + excluded;
+                dirty_clauses[j / 32] |= 1u << (j % 32);
+            }
+        }
+    }
+
+    // 생성(또는 fromMachine) 이후 결정 비트가 바뀐 automaton 수의 누적값
+    long long decisionFlips() const { return decision_flips; }
+    // clause번 절의 현재 Include 수
+    int includeCount(int clause) const { return include_count[clause]; }
+    // 결정 비트가 바뀐 절 비트맵을 out에 복사하고 비움 (TsetlinMachine::takeDirtyClauses와 같은 형식)
+    void takeDirtyClauses(vector<unsigned int>& out) {
+        out = dirty_clauses;
+        fill(dirty_clauses.begin(), dirty_clauses.end(), 0u);
+    }
+
+    int voteThreshold() const { return threshold; }
+
+private:
+    static constexpr int CLAUSE_WORDS = (Clauses + 31) / 32;
+
+    int threshold;
+    double s;
+    int stream_literals; // Type I 스트림에서 켜는 리터럴 수
+    vector<Word> ta_state;
+    vector<int> include_count;
+    long long decision_flips;
+    vector<unsigned int> dirty_clauses; // 결정 비트가 바뀐 절 (비트 단위)
+
+    Word& plane(int clause, int b, int chunk) {
+        return ta_state[((size_t)clause * StateBits + b) * LA_CHUNKS + chunk];
+    }
+    const Word& plane(int clause, int b, int chunk) const {
+        return ta_state[((size_t)clause * StateBits + b) * LA_CHUNKS + chunk];
+    }
+};
+
+// 고정 모양 다중 클래스 모델: 클래스마다 FixedTsetlinMachine 하나 (MultipleClassTsetlin과 같은 One-vs-All)
+template <int Classes, int Features, int Clauses, typename Word = uint64_t, int StateBits = 8>
+class FixedMultiClassTsetlin {
+    static_assert(Classes >= 2, "클래스는 2개 이상");
+
+public:
+    typedef FixedTsetlinMachine<Features, Clauses, Word, StateBits> Machine;
+    static constexpr int LA_CHUNKS = Machine::LA_CHUNKS;
+
+    ~FixedMultiClassTsetlin() {
+        for (Machine* machine : machines) {
+            delete machine;
+        }
+    }
+
+    FixedMultiClassTsetlin(const FixedMultiClassTsetlin&) = delete;
+    FixedMultiClassTsetlin& operator=(const FixedMultiClassTsetlin&) = delete;
+
+    // 학습된 모델의 상태를 복사 (클래스 수나 machine 모양이 다르면 nullptr)
+    static FixedMultiClassTsetlin* fromModel(const MultipleClassTsetlin& model) {
+        if (model.numClasses() != Classes)
+            return nullptr;
+        FixedMultiClassTsetlin* fixed = new FixedMultiClassTsetlin();
+        for (int i = 0; i < Classes; i++) {
+            Machine* machine = Machine::fromMachine(model.machine(i));
+            if (machine == nullptr) {
+                delete fixed;
+                return nullptr;
+            }
+            fixed->machines.push_back(machine);
+        }
+        return fixed;
+    }
+
+    // 같은 상태의 MultipleClassTsetlin 생성 (저장하거나 동적 경로에서 이어서 학습할 때)
+    MultipleClassTsetlin* toModel() const {
+        vector<TsetlinMachine*> converted;
+        for (const Machine* machine : machines) {
+            converted.push_back(machine->toMachine());
+        }
+        return MultipleClassTsetlin::fromMachines(converted);
+    }
+
+    // 가장 높은 점수의 클래스 (동점이면 앞 클래스). Xi는 LA_CHUNKS개의 Word (Machine::packInput 참고)
+    int predict(const Word* Xi) const {
+        int best_class = 0;
+        int best_score = 0;
+        for (int i = 0; i < Classes; i++) {
+            int score = machines[i]->score(Xi);
+            if (i == 0 || score > best_score) {
+                best_score = score;
+                best_class = i;
+            }
+        }
+        return best_class;
+    }
+
+    // 타깃 클래스는 target 1, 무작위로 고른 다른 클래스 하나는 target 0으로 update
+    void train(const Word* Xi, int target_class, uint64_t& rng) {
+        machines[target_class]->update(Xi, 1, rng);
+        int negative_class = TsetlinMachine::nextRandom(rng) % (Classes - 1);
+        if (negative_class >= target_class)
+            negative_class++;
+        machines[negative_class]->update(Xi, 0, rng);
+    }
+
+private:
+    FixedMultiClassTsetlin() {}
+    vector<Machine*> machines;
+};
+
+#endif //TSETLIN_MACHINE_FIXEDTSETLINMACHINE_H
@@ -0,0 +1,71 @@
+#include "IncrementalEvaluator.h"
+#include "ThreadPool.h"
+#include <atomic>
+using namespace std;
+
+int IncrementalEvaluator::addDataset(const Dataset& data) {
+    Entry dataset;
+    dataset.data = &data;
+    datasets.push_back(dataset);
+    return (int)datasets.size() - 1;
+}
+
+void IncrementalEvaluator::refresh(MultipleClassTsetlin& current) {
+    model = &current;
+    int num_classes = current.numClasses();
+
+    // 클래스별 dirty 비트맵을 한 번만 가져와 모든 데이터셋에 적용
+    vector<vector<unsigned int>> dirty(num_classes);
+    long long dirty_count = 0, total = 0;
+    for (int c = 0; c < num_classes; c++) {
+        current.machine(c).takeDirtyClauses(dirty[c]);
+        for (unsigned int word : dirty[c]) {
+            dirty_count += __builtin_popcount(word);
+        }
+        total += current.machine(c).numClauses();
+    }
+    last_dirty_fraction = total > 0 ? (double)dirty_count / total : 0.0;
+
+    for (auto& dataset : datasets) {
+        int num_examples = dataset.data->size();
+        // 처음 refresh하는 데이터셋은 캐시가 비어 있으므로 모든 절을 계산
+        bool fresh = dataset.cache.empty();
+        dataset.cache.resize(num_examples, vector<vector<unsigned int>>(num_classes));
+        // 예제 구간을 공용 풀에서 나눠 갱신 (예제마다 캐시가 따로 있으므로 구간끼리 겹치지 않음)
+        ThreadPool::shared().parallelFor(0, num_examples, [&](int begin, int end) {
+            for (int c = 0; c < num_classes; c++) {
+                vector<unsigned int> all(dirty[c].size(), ~0u);
+                const vector<unsigned int>& recompute = fresh ? all : dirty[c];
+                for (int i = begin; i < end; i++) {
+                    current.machine(c).refreshClauseOutputs(dataset.data->row(i), recompute, dataset.cache[i][c]);
+                }
+            }
+        });
+    }
+}
+
+double IncrementalEvaluator::accuracy(int index) {
+    Entry& dataset = datasets[index];
+    int num_examples = dataset.data->size();
+    int num_classes = model->numClasses();
+    atomic<int> errors(0);
+    ThreadPool::shared().parallelFor(0, num_examples, [&](int begin, int end) {
+        int range_errors = 0;
+        for (int i = begin; i < end; i++) {
+            // MultipleClassTsetlin::predict와 같이 점수가 가장 높은 (동점이면 앞) 클래스
+            int best_class = 0;
+            int best_score = 0;
+            for (int c = 0; c < num_classes; c++) {
+                int score = model->machine(c).votes(dataset.cache[i][c]);
+                if (c == 0 || score > best_score) {
+                    best_score = score;
+                    best_class = c;
+                }
+            }
+            if (best_class != dataset.data->label(i))
+                range_errors++;
+        }
+        errors += range_errors;
+    });
+    return 1.0 - static_cast<double>(errors.load()) / num_examples;
+}
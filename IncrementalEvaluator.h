@@ -0,0 +1,39 @@
+#ifndef TSETLIN_MACHINE_INCREMENTALEVALUATOR_H
+#define TSETLIN_MACHINE_INCREMENTALEVALUATOR_H
+
+#include "MultiClassTsetlin.h"
+#include <vector>
+using namespace std;
+
+// 증분 평가: 데이터셋의 예제마다 클래스별 절 출력 비트맵을 캐시해 두고,
+// 평가할 때는 마지막 평가 이후 결정 비트가 바뀐(dirty) 절만 다시 계산.
+// epoch당 평가 비용이 모델 크기가 아니라 바뀐 절의 수에 비례.
+//  – 같은 모델(또는 같은 모델에서 순서대로 뜬 스냅샷들)을 순서대로 refresh해야 함
+//  – refresh는 모델의 dirty 비트를 소비하므로, 여러 데이터셋은 한 evaluator에 등록하여 함께 갱신
+//  – 갱신과 정확도 계산은 예제 구간을 공용 스레드 풀(ThreadPool::shared)에서 나눠 처리
+class IncrementalEvaluator {
+public:
+    // 평가할 데이터셋 등록 (data는 evaluator보다 오래 살아 있어야 함). 데이터셋 번호를 반환
+    int addDataset(const Dataset& data);
+
+    // model의 dirty 절을 가져와 모든 데이터셋의 캐시를 갱신
+    void refresh(MultipleClassTsetlin& model);
+
+    // 캐시된 절 출력으로 정확도 계산 (refresh 이후 호출)
+    double accuracy(int dataset);
+
+    // 마지막 refresh에서 다시 계산한 절의 비율 (모든 클래스 기준)
+    double lastDirtyFraction() const { return last_dirty_fraction; }
+
+private:
+    struct Entry {
+        const Dataset* data;
+        // cache[example][class] = 절 출력 비트맵
+        vector<vector<vector<unsigned int>>> cache;
+    };
+    vector<Entry> datasets;
+    MultipleClassTsetlin* model = nullptr; // 마지막으로 refresh한 모델 (정확도 계산용)
+    double last_dirty_fraction = 1.0;
+};
+
+#endif //TSETLIN_MACHINE_INCREMENTALEVALUATOR_H
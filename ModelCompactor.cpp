@@ -0,0 +1,205 @@
+#include "ModelCompactor.h"
+#include <unordered_map>
+#include <algorithm>
+
+namespace {
+
+// 절 하나의 분석 결과
+struct ClauseInfo {
+    vector<int> include;   // Include된 리터럴 번호 (결정 비트 평면)
+    vector<uint64_t> fire; // 보정 데이터셋 예제별 출력 (비트 단위)
+    bool keep = true;
+};
+
+// Include 리터럴 목록의 FNV-1a 해시 (같은 결정 비트를 가진 절을 묶는 용도, 묶은 뒤 목록을 직접 비교)
+uint64_t hash_include(const vector<int>& include) {
+    uint64_t h = 1469598103934665603ULL;
+    for (int la : include) {
+        h ^= (uint64_t)la;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+int clip(int sum, int threshold) {
+    return max(-threshold, min(threshold, sum));
+}
+
+// 클립된 점수가 가장 높은 (동점이면 앞) 클래스: MultipleClassTsetlin::predict와 같은 규칙
+int argmax(const vector<vector<int>>& sums, const vector<int>& thresholds, int example) {
+    int best_class = 0;
+    int best_score = 0;
+    for (size_t c = 0; c < sums.size(); c++) {
+        int score = clip(sums[c][example], thresholds[c]);
+        if (c == 0 || score > best_score) {
+            best_score = score;
+            best_class = (int)c;
+        }
+    }
+    return best_class;
+}
+
+} // namespace
+
+MultipleClassTsetlin* ModelCompactor::compact(const MultipleClassTsetlin& model, const Dataset& calibration,
+                                              Report* report) {
+    int num_classes = model.numClasses();
+    int num_examples = calibration.size();
+    int fire_words = (num_examples + 63) / 64;
+    Report result;
+
+    vector<vector<ClauseInfo>> info(num_classes);
+    vector<vector<int>> sums(num_classes, vector<int>(num_examples, 0)); // 남은 절의 클립 전 투표 합
+    vector<int> thresholds(num_classes);
+    vector<vector<int>> duplicates(num_classes); // 제거를 시도할 같은 극성 중복 절
+
+    for (int c = 0; c < num_classes; c++) {
+        const TsetlinMachine& machine = model.machine(c);
+        int clauses = machine.numClauses();
+        thresholds[c] = machine.voteThreshold();
+        result.clauses_before += clauses;
+        info[c].resize(clauses);
+
+        // 예제마다 모든 절의 예측 모드 출력을 계산하여 절별 비트셋으로 전치
+        vector<unsigned int> all((clauses + 31) / 32, ~0u);
+        vector<unsigned int> output;
+        for (int j = 0; j < clauses; j++) {
+            machine.includedLiterals(j, info[c][j].include);
+            info[c][j].fire.assign(fire_words, 0);
+        }
+        for (int i = 0; i < num_examples; i++) {
+            machine.refreshClauseOutputs(calibration.row(i), all, output);
+            for (int j = 0; j < clauses; j++) {
+                if (output[j / 32] & (1u << (j % 32)))
+                    info[c][j].fire[i / 64] |= 1ULL << (i % 64);
+            }
+        }
+
+        // 모두 Exclude이거나 보정 데이터셋에서 켜지지 않는 절 제거
+        for (int j = 0; j < clauses; j++) {
+            ClauseInfo& clause = info[c][j];
+            if (clause.include.empty()) {
+                clause.keep = false;
+                result.empty++;
+            } else if (all_of(clause.fire.begin(), clause.fire.end(), [](uint64_t w) { return w == 0; })) {
+                clause.keep = false;
+                result.never_fired++;
+            }
+        }
+
+        // 결정 비트가 같은 절끼리 묶음: 반대 극성은 쌍으로 상쇄, 남은 같은 극성은 중복 후보
+        unordered_map<uint64_t, vector<int>> buckets;
+        for (int j = 0; j < clauses; j++) {
+            if (info[c][j].keep)
+                buckets[hash_include(info[c][j].include)].push_back(j);
+        }
+        for (auto& bucket : buckets) {
+            vector<int>& members = bucket.second;
+            for (size_t a = 0; a < members.size(); a++) {
+                int first = members[a];
+                if (first < 0)
+                    continue;
+                vector<int> positive, negative;
+                for (size_t b = a; b < members.size(); b++) {
+                    int j = members[b];
+                    if (j < 0 || info[c][j].include != info[c][first].include)
+                        continue;
+                    (j % 2 == 0 ? positive : negative).push_back(j);
+                    members[b] = -1;
+                }
+                size_t pairs = min(positive.size(), negative.size());
+                for (size_t p = 0; p < pairs; p++) {
+                    info[c][positive[p]].keep = false;
+                    info[c][negative[p]].keep = false;
+                }
+                result.opposite_pairs += (int)pairs;
+                // 같은 극성이 여러 개 남으면 하나를 제외한 나머지가 중복 후보
+                vector<int>& rest = positive.size() > pairs ? positive : negative;
+                for (size_t p = pairs + 1; p < rest.size(); p++) {
+                    duplicates[c].push_back(rest[p]);
+                }
+            }
+        }
+
+        for (int j = 0; j < clauses; j++) {
+            if (!info[c][j].keep)
+                continue;
+            int polarity = (j % 2 == 0) ? 1 : -1;
+            for (int w = 0; w < fire_words; w++) {
+                uint64_t bits = info[c][j].fire[w];
+                while (bits) {
+                    sums[c][w * 64 + __builtin_ctzll(bits)] += polarity;
+                    bits &= bits - 1;
+                }
+            }
+        }
+    }
+
+    // 원래 모델의 예측 (여기까지의 제거는 보정 데이터셋에서 투표 합을 바꾸지 않음)
+    vector<int> predictions(num_examples);
+    for (int i = 0; i < num_examples; i++) {
+        predictions[i] = argmax(sums, thresholds, i);
+    }
+
+    // 중복 절을 하나씩 빼 보고, 그 절이 켜지는 예제 중 예측이 바뀌는 것이 있으면 되돌림
+    for (int c = 0; c < num_classes; c++) {
+        for (int j : duplicates[c]) {
+            int polarity = (j % 2 == 0) ? 1 : -1;
+            const vector<uint64_t>& fire = info[c][j].fire;
+            bool changed = false;
+            for (int pass = 0; pass < 2; pass++) {
+                // pass 0: 빼 보고 예측 확인, pass 1: 예측이 바뀌었으면 되돌림
+                if (pass == 1 && !changed)
+                    break;
+                for (int w = 0; w < fire_words; w++) {
+                    uint64_t bits = fire[w];
+                    while (bits) {
+                        int i = w * 64 + __builtin_ctzll(bits);
+                        bits &= bits - 1;
+                        if (pass == 0) {
+                            sums[c][i] -= polarity;
+                            if (argmax(sums, thresholds, i) != predictions[i])
+                                changed = true;
+                        } else {
+                            sums[c][i] += polarity;
+                        }
+                    }
+                }
+            }
+            if (changed)
+                continue;
+            info[c][j].keep = false;
+            result.duplicates++;
+        }
+    }
+
+    // 남은 +절을 짝수 번, -절을 홀수 번에 배치 (부족한 쪽은 처음 상태인 빈 절로 남음)
+    vector<TsetlinMachine*> compacted;
+    for (int c = 0; c < num_classes; c++) {
+        const TsetlinMachine& machine = model.machine(c);
+        vector<int> positive, negative;
+        for (int j = 0; j < machine.numClauses(); j++) {
+            if (info[c][j].keep)
+                (j % 2 == 0 ? positive : negative).push_back(j);
+        }
+        int half = max(1, (int)max(positive.size(), negative.size()));
+        TsetlinMachine* target = new TsetlinMachine(2 * half, machine.voteThreshold(), machine.specificity(),
+                                                    machine.stateBits(), machine.numFeatures());
+        vector<unsigned int> planes(machine.stateBits());
+        for (int polarity = 0; polarity < 2; polarity++) {
+            const vector<int>& kept = polarity == 0 ? positive : negative;
+            for (size_t p = 0; p < kept.size(); p++) {
+                for (int k = 0; k < machine.literalWords(); k++) {
+                    machine.getChunk(kept[p], k, planes.data());
+                    target->setChunk(2 * (int)p + polarity, k, planes.data());
+                }
+            }
+        }
+        result.clauses_after += target->numClauses();
+        compacted.push_back(target);
+    }
+
+    if (report != nullptr)
+        *report = result;
+    return MultipleClassTsetlin::fromMachines(compacted);
+}
@@ -0,0 +1,31 @@
+#ifndef TSETLIN_MACHINE_MODELCOMPACTOR_H
+#define TSETLIN_MACHINE_MODELCOMPACTOR_H
+
+#include "MultiClassTsetlin.h"
+#include "Dataset.h"
+using namespace std;
+
+// 학습이 끝난 모델에서 평가할 필요가 없는 절을 제거하여 더 작은 모델을 만듦.
+//  – 모든 리터럴이 Exclude인 절: 예측 모드에서 항상 0 (어떤 입력에서도 결과 동일)
+//  – 결정 비트가 같은 +/- 절 쌍: 항상 같이 켜지고 꺼지므로 투표가 상쇄됨 (어떤 입력에서도 결과 동일)
+//  – 보정 데이터셋에서 한 번도 켜지지 않는 절
+//  – 결정 비트가 같은 같은 극성의 중복 절 (하나만 남기면 투표 수가 줄어드므로 보정 데이터셋에서 예측이 바뀌지 않을 때만 제거)
+// 뒤의 두 경우는 보정 데이터셋의 예측이 그대로인지 확인하며 제거하므로, 결과 모델은 보정 데이터셋에서 원래 모델과 같은 예측을 냄.
+// 절의 극성은 번호의 짝/홀로 정해지므로 남은 +절과 -절을 번갈아 다시 배치하고, 수가 다르면 빈 절로 채움
+class ModelCompactor {
+public:
+    struct Report {
+        int clauses_before = 0;
+        int clauses_after = 0;  // 극성을 맞추기 위해 채운 빈 절 포함
+        int empty = 0;          // 모두 Exclude
+        int opposite_pairs = 0; // 상쇄되는 +/- 쌍 (쌍의 수)
+        int never_fired = 0;    // 보정 데이터셋에서 켜지지 않음
+        int duplicates = 0;     // 같은 극성의 중복
+    };
+
+    // 압축한 새 모델을 반환 (호출자가 소유, 원본은 바뀌지 않음)
+    static MultipleClassTsetlin* compact(const MultipleClassTsetlin& model, const Dataset& calibration,
+                                         Report* report = nullptr);
+};
+
+#endif //TSETLIN_MACHINE_MODELCOMPACTOR_H
@@ -0,0 +1,100 @@
+#include "ModelHandle.h"
+#include <sys/stat.h>
+#include <chrono>
+using namespace std;
+
+ModelHandle::ReadGuard::ReadGuard(ModelHandle* handle, int reader) : handle(handle), reader(reader) {
+    if (reader < 0 || reader >= (int)handle->slots.size()) {
+        this->reader = -1;
+        model = nullptr;
+        return;
+    }
+    // epoch를 먼저 알린 뒤 포인터를 읽음: 교체하는 쪽이 이 슬롯을 0으로 보았다면
+    // 이 포인터 읽기는 교체 이후이므로 반드시 새 모델을 얻음
+    handle->slots[reader].epoch.store(handle->global_epoch.load());
+    model = handle->current.load();
+}
+
+ModelHandle::ReadGuard::~ReadGuard() {
+    if (reader >= 0)
+        handle->slots[reader].epoch.store(0, memory_order_release);
+}
+
+ModelHandle::ModelHandle(MultipleClassTsetlin* initial, int max_readers)
+        : current(initial), global_epoch(1), slots(max_readers), next_slot(0), swaps(0), failures(0),
+          watching(false), reload_requested(false) {
+}
+
+ModelHandle::~ModelHandle() {
+    if (watching) {
+        watching = false;
+        watcher.join();
+    }
+    delete current.load();
+}
+
+int ModelHandle::registerReader() {
+    // 슬롯이 모자라면 번호를 늘리지 않고 -1 (반복 호출해도 넘치지 않음)
+    int slot = next_slot.load();
+    while (slot < (int)slots.size()) {
+        if (next_slot.compare_exchange_weak(slot, slot + 1))
+            return slot;
+    }
+    return -1;
+}
+
+void ModelHandle::swap(MultipleClassTsetlin* next) {
+    lock_guard<mutex> lock(writer_mtx);
+    MultipleClassTsetlin* old = current.exchange(next);
+    unsigned long long retire_epoch = global_epoch.fetch_add(1) + 1;
+
+    // 이전 epoch로 읽기 구간에 들어간 스레드가 모두 나갈 때까지 대기
+    for (auto& slot : slots) {
+        while (true) {
+            unsigned long long epoch = slot.epoch.load();
+            if (epoch == 0 || epoch >= retire_epoch)
+                break;
+            this_thread::yield();
+        }
+    }
+    delete old;
+    swaps++;
+}
+
+void ModelHandle::watch(const string& path, int interval_ms, ReloadCallback on_reload) {
+    if (watching)
+        return;
+    watching = true;
+    watcher = thread([this, path, interval_ms, on_reload]() {
+        struct stat info;
+        long long last_mtime = 0, last_size = 0;
+        if (stat(path.c_str(), &info) == 0) {
+            last_mtime = (long long)info.st_mtim.tv_sec * 1000000000LL + info.st_mtim.tv_nsec;
+            last_size = info.st_size;
+        }
+        while (watching) {
+            this_thread::sleep_for(chrono::milliseconds(interval_ms));
+            if (stat(path.c_str(), &info) != 0)
+                continue;
+            long long mtime = (long long)info.st_mtim.tv_sec * 1000000000LL + info.st_mtim.tv_nsec;
+            bool changed = mtime != last_mtime || info.st_size != last_size;
+            if (!changed && !reload_requested.exchange(false))
+                continue;
+
+            // 불러오기는 이 스레드에서 끝낸 뒤 게시하므로 읽는 쪽은 교체 중에도 지연되지 않음
+            MultipleClassTsetlin* next = MultipleClassTsetlin::load(path);
+            if (next == nullptr) {
+                // 쓰는 중인 파일일 수 있으므로 기록을 갱신하지 않고 다음 확인 때 다시 시도
+                failures++;
+                if (on_reload)
+                    on_reload(path, false);
+                continue;
+            }
+            last_mtime = mtime;
+            last_size = info.st_size;
+            swap(next);
+            if (on_reload)
+                on_reload(path, true);
+        }
+    });
+}
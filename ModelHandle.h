@@ -0,0 +1,84 @@
+#ifndef TSETLIN_MACHINE_MODELHANDLE_H
+#define TSETLIN_MACHINE_MODELHANDLE_H
+
+#include "MultiClassTsetlin.h"
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <string>
+#include <vector>
+using namespace std;
+
+// 무중단 모델 교체용 핸들: 읽는 쪽은 잠금 없이 현재 모델 포인터를 얻고,
+// 교체하는 쪽은 새 모델을 원자적으로 게시한 뒤 이전 모델을 읽던 모든 구간이 끝나면 삭제 (epoch 기반 회수).
+//  – 읽기: 자기 슬롯에 현재 epoch를 기록 → 포인터 읽기 → 끝나면 슬롯을 0으로 (원자 store 2번)
+//  – 교체: 포인터 exchange → epoch 증가 → 모든 슬롯이 0이거나 새 epoch 이상이 될 때까지 대기 → 삭제
+class ModelHandle {
+public:
+    // 읽기 구간: 살아 있는 동안 가리키는 모델이 삭제되지 않음.
+    // 잘못된 슬롯 번호(registerReader의 -1 등)로 만들면 슬롯을 건드리지 않고 get()이 nullptr
+    class ReadGuard {
+    public:
+        ReadGuard(ModelHandle* handle, int reader);
+        ~ReadGuard();
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+
+        // 읽기 전용: 여러 작업자가 같은 모델을 공유하므로 const 경로(predict 등)만 사용
+        const MultipleClassTsetlin* get() const { return model; }
+        const MultipleClassTsetlin* operator->() const { return model; }
+
+    private:
+        ModelHandle* handle;
+        int reader;
+        MultipleClassTsetlin* model;
+    };
+
+    // initial의 소유권을 가져감. max_readers: 동시에 읽을 수 있는 스레드 수 (슬롯 수)
+    explicit ModelHandle(MultipleClassTsetlin* initial, int max_readers = 64);
+    ~ModelHandle();
+
+    ModelHandle(const ModelHandle&) = delete;
+    ModelHandle& operator=(const ModelHandle&) = delete;
+
+    // 읽기 스레드마다 한 번 호출하여 슬롯 번호를 받음 (슬롯이 모자라면 -1)
+    int registerReader();
+    // reader 슬롯으로 읽기 구간 시작 (reader가 등록된 슬롯 번호가 아니면 모델 없이 반환)
+    ReadGuard read(int reader) { return ReadGuard(this, reader); }
+
+    // next를 게시하고, 이전 모델을 읽던 구간이 모두 끝나면 이전 모델을 삭제 (읽기 스레드에서 호출 금지)
+    void swap(MultipleClassTsetlin* next);
+
+    // 불러오기 시도마다 감시 스레드에서 호출: 교체했으면 true, 파일을 읽지 못했으면 false (출력은 호출자가 결정)
+    typedef function<void(const string& path, bool reloaded)> ReloadCallback;
+
+    // 백그라운드 스레드가 path를 interval_ms마다 확인하여, 수정 시각이나 크기가 바뀌면 불러와 교체
+    void watch(const string& path, int interval_ms = 1000, ReloadCallback on_reload = nullptr);
+    // 다음 확인 때 파일 변경 여부와 관계없이 다시 불러오도록 요청 (예: SIGHUP)
+    void requestReload() { reload_requested = true; }
+    // 지금까지 교체된 횟수와, 감시 중 불러오기에 실패한 횟수
+    long long reloads() const { return swaps.load(); }
+    long long reloadFailures() const { return failures.load(); }
+
+private:
+    // 슬롯마다 캐시 라인을 따로 사용하여 읽기 스레드 간 거짓 공유를 피함
+    struct alignas(64) Slot {
+        atomic<unsigned long long> epoch;
+        Slot() : epoch(0) {}
+    };
+
+    atomic<MultipleClassTsetlin*> current;
+    atomic<unsigned long long> global_epoch;
+    vector<Slot> slots;
+    atomic<int> next_slot;
+    mutex writer_mtx; // 교체끼리만 직렬화 (읽기 경로에는 잠금 없음)
+    atomic<long long> swaps;
+    atomic<long long> failures;
+
+    thread watcher;
+    atomic<bool> watching;
+    atomic<bool> reload_requested;
+};
+
+#endif //TSETLIN_MACHINE_MODELHANDLE_H
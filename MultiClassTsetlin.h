@@ -3,24 +3,37 @@
 #define TSETLIN_MACHINE_MULTICLASSTSETLIN_H
 
 #include "TsetlinMachine.h"
+#include "Dataset.h"
+#include "DataLoader.h"
+#include "EarlyStopping.h"
+#include "ThreadPool.h"
 #include <vector>
 #include <cstdlib>
 #include <ctime>
 #include <iostream>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <memory>
 
 using namespace std;
 
 class MultipleClassTsetlin {
 public:
 
-    MultipleClassTsetlin(int num_classes, int clauses, int threshold, double s)
-            : num_classes(num_classes)
+    // state_bits: 각 automaton의 비트 평면 수, features: 입력 특성 수 (TsetlinMachine 참고)
+    MultipleClassTsetlin(int num_classes, int clauses, int threshold, double s, int state_bits = 8,
+                         int features = 784)
+            : num_classes(num_classes), mini_batch(1), pending(0)
     {
 
         srand((unsigned)time(0));
+        seed_from_rand();
 
         for (int i = 0; i < num_classes; i++) {
-            machines.push_back(new TsetlinMachine(clauses, threshold, s));
+            machines.push_back(new TsetlinMachine(clauses, threshold, s, state_bits, features));
         }
     }
 
@@ -30,25 +43,167 @@ public:
         }
     }
 
+    // machine 포인터를 소유하므로 복사는 snapshot()으로만
+    MultipleClassTsetlin(const MultipleClassTsetlin&) = delete;
+    MultipleClassTsetlin& operator=(const MultipleClassTsetlin&) = delete;
+
+    // 이미 만든 machine들로 모델 구성 (machine 소유권을 가져감, 클래스 순서대로)
+    static MultipleClassTsetlin* fromMachines(const vector<TsetlinMachine*>& class_machines) {
+        MultipleClassTsetlin* model = new MultipleClassTsetlin();
+        model->machines = class_machines;
+        model->num_classes = (int)class_machines.size();
+        return model;
+    }
+
+    // 현재 상태의 독립된 복사본 (비트 평면 복사). 학습과 동시에 다른 스레드에서 평가할 때 사용.
+    // 학습 스레드에서 update가 진행 중이지 않을 때 호출해야 함
+    MultipleClassTsetlin* snapshot() const {
+        MultipleClassTsetlin* copy = new MultipleClassTsetlin();
+        for (int i = 0; i < num_classes; i++) {
+            copy->machines.push_back(machines[i]->clone());
+            copy->num_classes++;
+        }
+        return copy;
+    }
+
+    // 모델 파일 저장: 머리("TSTM", 버전, 클래스 수) 뒤에 클래스별 machine을 순서대로 기록
+    bool save(const string& filename) const {
+        ofstream out(filename, ios::binary);
+        if (!out)
+            return false;
+        return save(out);
+    }
+    bool save(ostream& out) const {
+        int version = MODEL_VERSION;
+        out.write(MODEL_MAGIC, 4);
+        out.write(reinterpret_cast<const char*>(&version), sizeof(version));
+        out.write(reinterpret_cast<const char*>(&num_classes), sizeof(num_classes));
+        for (int i = 0; i < num_classes; i++) {
+            machines[i]->save(out);
+        }
+        return (bool)out;
+    }
+
+    // 모델 파일 불러오기 (파일이 없거나 형식이 맞지 않으면 nullptr)
+    static MultipleClassTsetlin* load(const string& filename) {
+        ifstream in(filename, ios::binary);
+        if (!in)
+            return nullptr;
+        return load(in);
+    }
+    static MultipleClassTsetlin* load(istream& in) {
+        char magic[4];
+        int version = 0, classes = 0;
+        in.read(magic, 4);
+        in.read(reinterpret_cast<char*>(&version), sizeof(version));
+        in.read(reinterpret_cast<char*>(&classes), sizeof(classes));
+        if (!in || string(magic, 4) != string(MODEL_MAGIC, 4) || version != MODEL_VERSION || classes < 2)
+            return nullptr;
+
+        MultipleClassTsetlin* model = new MultipleClassTsetlin();
+        for (int i = 0; i < classes; i++) {
+            TsetlinMachine* machine = TsetlinMachine::load(in);
+            if (machine == nullptr) {
+                delete model;
+                return nullptr;
+            }
+            model->machines.push_back(machine);
+            model->num_classes++;
+        }
+        return model;
+    }
+
+    int numClasses() const { return num_classes; }
+    TsetlinMachine& machine(int class_index) { return *machines[class_index]; }
+    const TsetlinMachine& machine(int class_index) const { return *machines[class_index]; }
+
+    // 모든 machine의 dirty 절 비트맵 비우기 (snapshot()이 dirty 비트를 복사해 간 뒤 호출)
+    void clearDirtyClauses() {
+        for (int i = 0; i < num_classes; i++) {
+            machines[i]->clearDirtyClauses();
+        }
+    }
+
 
 
  //타깃 클래스에는 긍정 피드백(1), 임의의 다른 클래스에는 부정 피드백(0)을 적용.
-    void train(const vector<unsigned int>& Xi, int target_class) {
-        // 타깃 클래스에 대해 긍정 피드백 업데이트
-        machines[target_class]->update(Xi, 1);
+    void train(const vector<unsigned int>& Xi, int target_class) { train(Xi.data(), target_class); }
+    // 미니배치 모드(setMiniBatch)에서는 피드백을 누적만 하고 mini_batch개마다 한 번에 반영
+    void train(const unsigned int* Xi, int target_class) {
+        if (mini_batch > 1) {
+            machines[target_class]->accumulate(Xi, 1);
+        } else {
+            // 타깃 클래스에 대해 긍정 피드백 업데이트
+            machines[target_class]->update(Xi, 1);
+        }
 
         // 타깃 클래스와 다른 임의의 클래스 선택 (클래스 수가 2 이상이라고 가정)
-        int negative_class = rand() % (num_classes - 1);
+        int negative_class = TsetlinMachine::nextRandom(rng) % (num_classes - 1);
         if (negative_class >= target_class) {
             negative_class++;  // target_class와 중복되지 않도록 조정
         }
-        machines[negative_class]->update(Xi, 0);
+        if (mini_batch > 1) {
+            machines[negative_class]->accumulate(Xi, 0);
+            if (++pending >= mini_batch)
+                flushMiniBatch();
+        } else {
+            machines[negative_class]->update(Xi, 0);
+        }
+    }
+
+    // 미니배치 학습 모드: examples > 1이면 train(Xi, target_class)가 ta_state를 바로 바꾸지 않고
+    // 클래스별 증감 버퍼에 누적하다가 examples개마다 절당 한 번의 포화 덧셈으로 반영 (TsetlinMachine::accumulate).
+    // fit은 끝날 때 남은 누적분을 반영하고, train을 직접 호출했다면 예측/저장 전에 flushMiniBatch를 호출해야 함.
+    // scratch를 받는 train(Hogwild)은 항상 온라인 update
+    void setMiniBatch(int examples) {
+        flushMiniBatch();
+        mini_batch = max(1, examples);
+    }
+    int miniBatch() const { return mini_batch; }
+    // 누적된 증감을 모든 machine에 반영
+    void flushMiniBatch() {
+        if (pending == 0)
+            return;
+        for (int i = 0; i < num_classes; i++) {
+            machines[i]->applyAccumulated();
+        }
+        pending = 0;
+    }
+
+
+
+    // train(Xi, target_class, scratch)에 넘길 scratch 생성.
+    // 압축된 모델은 클래스마다 절 수가 다를 수 있으므로 가장 큰 machine 기준으로 만듦
+    TsetlinMachine::Scratch createScratch() const {
+        int largest = 0;
+        for (int i = 1; i < num_classes; i++) {
+            if (machines[i]->numClauses() > machines[largest]->numClauses())
+                largest = i;
+        }
+        return machines[largest]->createScratch();
+    }
+
+    // scratch 버전: scratch가 가장 큰 machine 크기이므로 하나를 클래스 간에 재사용.
+    // 부정 클래스 선택도 scratch의 난수를 사용하여 스레드 간에 공유 상태가 없음.
+    void train(const vector<unsigned int>& Xi, int target_class, TsetlinMachine::Scratch& scratch) {
+        train(Xi.data(), target_class, scratch);
+    }
+    void train(const unsigned int* Xi, int target_class, TsetlinMachine::Scratch& scratch) {
+        machines[target_class]->update(Xi, 1, scratch);
+
+        int negative_class = scratch.next_random() % (num_classes - 1);
+        if (negative_class >= target_class) {
+            negative_class++;
+        }
+        machines[negative_class]->update(Xi, 0, scratch);
     }
 
 
 
      // 가장 높은 점수를 가진 클래스의 인덱스를 반환합니다.
-    int predict(const vector<unsigned int>& Xi) {
+     // const: 모델 상태에 쓰지 않으므로 여러 스레드가 복사나 잠금 없이 같은 모델로 동시에 예측 가능
+    int predict(const vector<unsigned int>& Xi) const { return predict(Xi.data()); }
+    int predict(const unsigned int* Xi) const {
         int best_class = 0;
         int best_score = machines[0]->score(Xi);
         for (int i = 1; i < num_classes; i++) {
@@ -62,33 +217,331 @@ public:
     }
 
 
-    //predict 여러번
-    double evaluate(const vector<vector<unsigned int>>& X, const vector<int>& y) {
-        int errors = 0;
+    // 스레드별 scratch를 사용하는 predict: 여러 스레드가 같은 모델로 동시에 예측 가능.
+    // scores가 nullptr가 아니면 클래스별 점수를 기록
+    int predict(const vector<unsigned int>& Xi, TsetlinMachine::Scratch& scratch,
+                vector<int>* scores = nullptr) const {
+        return predict(Xi.data(), scratch, scores != nullptr ? scores->data() : nullptr);
+    }
+    int predict(const unsigned int* Xi, TsetlinMachine::Scratch& scratch, int* scores) const {
+        int best_class = 0;
+        int best_score = 0;
+        for (int i = 0; i < num_classes; i++) {
+            int score = machines[i]->score(Xi, scratch);
+            if (scores != nullptr)
+                scores[i] = score;
+            if (i == 0 || score > best_score) {
+                best_score = score;
+                best_class = i;
+            }
+        }
+        return best_class;
+    }
+
+    // 배치 예측: 예제 i는 X + i * stride (워드 단위)에서 시작하며 예측 클래스를 out[i]에 기록.
+    // 클래스별로 배치 전체를 점수 매기므로 한 machine의 상태가 캐시에 남은 채로 행들을 순서대로 읽음.
+    // scores가 nullptr가 아니면 scores[i * numClasses() + c]에 클래스별 점수를 기록
+    void predictBatch(const unsigned int* X, size_t stride, int count, int* out,
+                      TsetlinMachine::Scratch& scratch, int* scores = nullptr) const {
+        vector<int> best_score(count), score(count);
+        for (int i = 0; i < num_classes; i++) {
+            machines[i]->scoreBatch(X, stride, count, score.data(), scratch);
+            for (int e = 0; e < count; e++) {
+                if (scores != nullptr)
+                    scores[(size_t)e * num_classes + i] = score[e];
+                if (i == 0 || score[e] > best_score[e]) {
+                    best_score[e] = score[e];
+                    out[e] = i;
+                }
+            }
+        }
+    }
+    // scratch 없이: 공용 풀에서 예제 구간을 나눠 구간마다 scratch를 만들어 예측
+    void predictBatch(const unsigned int* X, size_t stride, int count, int* out) const {
+        ThreadPool& pool = ThreadPool::shared();
+        pool.parallelFor(0, count, [&](int first, int last) {
+            TsetlinMachine::Scratch scratch = createScratch();
+            predictBatch(X + first * stride, stride, last - first, out + first, scratch);
+        }, max(MIN_PARALLEL_EXAMPLES, count / (pool.size() * 4)));
+    }
+
+    // 배치 학습: 예제 i (X + i * stride)를 클래스 y[i]로 순서대로 train
+    void trainBatch(const unsigned int* X, size_t stride, const int* y, int count) {
+        for (int i = 0; i < count; i++) {
+            train(X + i * stride, y[i]);
+        }
+    }
+
+    // 공용 풀에서 예제 구간별로 배치 예측하여 정확도 계산
+    double evaluate(const Dataset& data) const {
+        static const int BATCH = 256;
+        int num_examples = data.size();
+        atomic<int> errors(0);
+        ThreadPool& pool = ThreadPool::shared();
+        pool.parallelFor(0, num_examples, [&](int begin, int end) {
+            TsetlinMachine::Scratch scratch = createScratch();
+            vector<int> predicted(BATCH);
+            int range_errors = 0;
+            for (int first = begin; first < end; first += BATCH) {
+                int count = min(BATCH, end - first);
+                predictBatch(data.row(first), data.stride(), count, predicted.data(), scratch);
+                for (int i = 0; i < count; i++) {
+                    if (predicted[i] != data.label(first + i))
+                        range_errors++;
+                }
+            }
+            errors += range_errors;
+        }, max(MIN_PARALLEL_EXAMPLES, num_examples / (pool.size() * 4)));
+        return 1.0 - static_cast<double>(errors.load()) / num_examples;
+    }
+
+    //predict 여러번 (공용 풀에서 예제 구간별로)
+    double evaluate(const vector<vector<unsigned int>>& X, const vector<int>& y) const {
         int num_examples = X.size();
-        for (int i = 0; i < num_examples; i++) {
-            int predicted = predict(X[i]);
-            if (predicted != y[i]) {
-                errors++;
+        atomic<int> errors(0);
+        ThreadPool& pool = ThreadPool::shared();
+        pool.parallelFor(0, num_examples, [&](int begin, int end) {
+            int range_errors = 0;
+            for (int i = begin; i < end; i++) {
+                int predicted = predict(X[i]);
+                if (predicted != y[i]) {
+                    range_errors++;
+                }
             }
+            errors += range_errors;
+        }, max(MIN_PARALLEL_EXAMPLES, num_examples / (pool.size() * 4)));
+        return 1.0 - static_cast<double>(errors.load()) / num_examples;
+    }
+
+    // 모든 클래스 machine의 automaton 상태값을 클래스 순서대로 이어붙여 내보내기/가져오기
+    int numAutomata() const {
+        int total = 0;
+        for (int i = 0; i < num_classes; i++) {
+            total += machines[i]->numAutomata();
+        }
+        return total;
+    }
+    void exportStates(int* out) const {
+        for (int i = 0; i < num_classes; i++) {
+            machines[i]->exportStates(out);
+            out += machines[i]->numAutomata();
+        }
+    }
+    void importStates(const int* in) {
+        for (int i = 0; i < num_classes; i++) {
+            machines[i]->importStates(in);
+            in += machines[i]->numAutomata();
+        }
+    }
+
+    // 모든 클래스의 machine에 절 샤딩을 설정 (pool은 호출자가 소유, 클래스들이 공유)
+    void setClauseShards(int num_shards, ThreadPool* pool) {
+        for (int i = 0; i < num_classes; i++) {
+            machines[i]->setClauseShards(num_shards, pool);
+        }
+    }
+
+    // 모든 클래스의 machine에 흡수 상태 경계를 설정
+    void setAbsorbingState(int lower, int upper) {
+        for (int i = 0; i < num_classes; i++) {
+            machines[i]->setAbsorbingState(lower, upper);
+        }
+    }
+
+    // 모든 클래스의 machine에 절당 리터럴 예산을 설정 (0 이하이면 제한 없음)
+    void setLiteralBudget(int max_literals) {
+        for (int i = 0; i < num_classes; i++) {
+            machines[i]->setLiteralBudget(max_literals);
         }
-        return 1.0 - static_cast<double>(errors) / num_examples;
     }
 
     //배치 사용 시
     void fit(const vector<vector<unsigned int>>& X, const vector<int>& y, int epochs) {
         int num_examples = X.size();
+        vector<int> order(num_examples);
+        for (int i = 0; i < num_examples; i++) {
+            order[i] = i;
+        }
         for (int epoch = 0; epoch < epochs; epoch++) {
-            //데이터 셔플링
+            //데이터 셔플링 (Fisher-Yates)
+            for (int i = num_examples - 1; i > 0; i--) {
+                swap(order[i], order[TsetlinMachine::nextRandom(rng) % (i + 1)]);
+            }
             for (int i = 0; i < num_examples; i++) {
-                train(X[i], y[i]);
+                train(X[order[i]], y[order[i]]);
+            }
+        }
+        flushMiniBatch();
+    }
+
+    // 이 모델의 난수 상태로 seed한 셔플링 로더. 학습 전체(epochs번)에 하나만 만들어 epoch마다 fitEpoch에 넘기면
+    // 로더 스레드도 한 번만 생기고, epoch 경계에서도 다음 epoch의 배치가 미리 준비됨
+    unique_ptr<DataLoader> makeLoader(const Dataset& data, int epochs, int batch_size = 256) {
+        uint64_t seed = ((uint64_t)TsetlinMachine::nextRandom(rng) << 32) | TsetlinMachine::nextRandom(rng);
+        return unique_ptr<DataLoader>(new DataLoader(data, batch_size, epochs, seed));
+    }
+
+    // 로더의 다음 epoch 하나를 배치 순서대로 학습하고 남은 미니 배치 누적분을 반영.
+    // 로더에 남은 epoch가 없었으면 false
+    bool fitEpoch(DataLoader& loader) {
+        if (loader.done())
+            return false;
+        const Dataset* batch;
+        while ((batch = loader.next()) != nullptr) {
+            trainBatch(batch->data(), batch->stride(), batch->labels(), batch->size());
+        }
+        flushMiniBatch();
+        return true;
+    }
+
+    // 연속 데이터셋 학습: 백그라운드 로더가 epoch마다 순열을 섞어 다음 배치를 연속 버퍼에 모으는 동안
+    // 현재 배치를 순서대로 학습 (batch_size는 로더가 한 번에 모으는 예제 수일 뿐, 학습은 예제 단위)
+    void fit(const Dataset& data, int epochs, int batch_size = 256) {
+        unique_ptr<DataLoader> loader = makeLoader(data, epochs, batch_size);
+        while (fitEpoch(*loader)) {
+        }
+    }
+
+    // 조기 종료 학습: epoch마다 validation 정확도와 결정 비트 변화율을 policy에 기록하고,
+    // policy가 멈추라고 하거나 max_epochs에 도달하면 종료. 모델은 최고 정확도 epoch의 상태로 복원됨.
+    // 실제로 학습한 epoch 수를 반환
+    int fit(const Dataset& data, int max_epochs, const Dataset& validation, EarlyStopping& policy) {
+        MultipleClassTsetlin* best = nullptr;
+        long long flips = decisionFlips();
+        // 로더는 max_epochs 전체에 하나 (조기 종료하면 남은 epoch는 로더 소멸 시 중단)
+        unique_ptr<DataLoader> loader = makeLoader(data, max_epochs);
+        int epoch = 0;
+        while (epoch < max_epochs) {
+            fitEpoch(*loader);
+            epoch++;
+            long long now = decisionFlips();
+            double churn = (double)(now - flips) / numAutomata();
+            flips = now;
+            if (policy.record(evaluate(validation), churn)) {
+                delete best;
+                best = snapshot();
             }
+            if (policy.shouldStop())
+                break;
+        }
+        if (best != nullptr) {
+            copyStatesFrom(*best);
+            delete best;
+        }
+        return epoch;
+    }
+
+    // 체크포인트용 난수 상태: 이 모델의 상태, 이어서 클래스마다 (개수, machine의 randomState())
+    vector<uint64_t> randomState() const {
+        vector<uint64_t> state(1, rng);
+        for (int i = 0; i < num_classes; i++) {
+            vector<uint64_t> machine_state = machines[i]->randomState();
+            state.push_back(machine_state.size());
+            state.insert(state.end(), machine_state.begin(), machine_state.end());
+        }
+        return state;
+    }
+    // randomState()로 기록한 상태 복원 (형식이 맞지 않으면 false)
+    bool setRandomState(const vector<uint64_t>& state) {
+        if (state.empty())
+            return false;
+        size_t pos = 1;
+        for (int i = 0; i < num_classes; i++) {
+            if (pos >= state.size() || state[pos] > state.size() - pos - 1)
+                return false;
+            pos += 1 + state[pos];
+        }
+        pos = 1;
+        for (int i = 0; i < num_classes; i++) {
+            size_t count = state[pos];
+            machines[i]->setRandomState(vector<uint64_t>(state.begin() + pos + 1, state.begin() + pos + 1 + count));
+            pos += 1 + count;
+        }
+        rng = state[0];
+        return true;
+    }
+
+    // 모든 machine의 결정 비트 변경 누적 수
+    long long decisionFlips() const {
+        long long total = 0;
+        for (int i = 0; i < num_classes; i++) {
+            total += machines[i]->decisionFlips();
+        }
+        return total;
+    }
+
+    // 같은 구조(클래스 수, 절 수, 리터럴 수)의 other에서 automaton 상태만 복사.
+    // 절 샤딩, 흡수 상태, 리터럴 예산 등 이 모델의 설정은 유지
+    void copyStatesFrom(const MultipleClassTsetlin& other) {
+        vector<int> states(numAutomata());
+        other.exportStates(states.data());
+        importStates(states.data());
+    }
+
+    // Hogwild 병렬 학습: num_threads개의 작업이 서로 다른 예제로 같은 machine들을 잠금 없이 동시에 갱신.
+    // epoch마다 공용 풀에서 작업 t가 i % num_threads == t 인 예제를 처리하며, 작업별 scratch를 사용.
+    // 작업들이 실제로 동시에 돌도록 num_threads는 풀 크기(TM_THREADS)로 제한 (1이면 일반 fit)
+    void fitHogwild(const vector<vector<unsigned int>>& X, const vector<int>& y, int epochs, int num_threads) {
+        ThreadPool& pool = ThreadPool::shared();
+        num_threads = min(num_threads, pool.size());
+        if (num_threads <= 1) {
+            fit(X, y, epochs);
+            return;
+        }
+        int num_examples = X.size();
+        vector<TsetlinMachine::Scratch> scratches;
+        for (int t = 0; t < num_threads; t++) {
+            scratches.push_back(createScratch());
+            scratches.back().hogwild = true;
+        }
+        for (int epoch = 0; epoch < epochs; epoch++) {
+            pool.run(num_threads, [&](int t) {
+                for (int i = t; i < num_examples; i += num_threads) {
+                    train(X[i], y[i], scratches[t]);
+                }
+            });
+        }
+    }
+    void fitHogwild(const Dataset& data, int epochs, int num_threads) {
+        ThreadPool& pool = ThreadPool::shared();
+        num_threads = min(num_threads, pool.size());
+        if (num_threads <= 1) {
+            fit(data, epochs);
+            return;
+        }
+        int num_examples = data.size();
+        vector<TsetlinMachine::Scratch> scratches;
+        for (int t = 0; t < num_threads; t++) {
+            scratches.push_back(createScratch());
+            scratches.back().hogwild = true;
+        }
+        for (int epoch = 0; epoch < epochs; epoch++) {
+            pool.run(num_threads, [&](int t) {
+                for (int i = t; i < num_examples; i += num_threads) {
+                    train(data.row(i), data.label(i), scratches[t]);
+                }
+            });
         }
     }
 
 private:
+    static constexpr const char* MODEL_MAGIC = "TSTM";
+    static const int MODEL_VERSION = 2; // 2: 비트 평면 수 가변, [절][비트][청크] 순서
+    static const int MIN_PARALLEL_EXAMPLES = 64; // 공용 풀에 나눠 줄 예제 구간의 최소 크기 (구간마다 scratch 생성)
+
+    // load 전용: machine 없이 생성한 뒤 하나씩 추가
+    MultipleClassTsetlin() : num_classes(0), mini_batch(1), pending(0) { seed_from_rand(); }
+
+    // 부정 클래스 선택과 셔플에 쓰는 난수 상태를 rand()에서 가져옴 (xorshift 상태는 0이 아니어야 함)
+    void seed_from_rand() {
+        rng = ((((uint64_t)rand() << 32) ^ (uint64_t)rand()) * 0x9E3779B97F4A7C15ULL) | 1;
+    }
+
     int num_classes;                        // 분류할 클래스 수
     vector<TsetlinMachine*> machines;       // 각 클래스별 TsetlinMachine 인스턴스
+    uint64_t rng;                           // train(Xi, target_class)와 fit의 난수 상태
+    int mini_batch;                         // 미니배치 크기 (1이면 온라인 update)
+    int pending;                            // 아직 반영하지 않은 누적 예제 수
 };
 
 #endif //TSETLIN_MACHINE_MULTICLASSTSETLIN_H
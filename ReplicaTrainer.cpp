@@ -0,0 +1,124 @@
+#include "ReplicaTrainer.h"
+#include "ThreadPool.h"
+#include <chrono>
+#include <algorithm>
+using namespace std;
+using namespace std::chrono;
+
+ReplicaTrainer::ReplicaTrainer(int replicas, int num_classes, int clauses, int threshold, double s,
+                               int state_bits, int features, int sync_interval, SyncMode mode)
+        : num_replicas(max(replicas, 1)), sync_interval(sync_interval), mode(mode) {
+    for (int r = 0; r < num_replicas; r++) {
+        this->replicas.push_back(new MultipleClassTsetlin(num_classes, clauses, threshold, s, state_bits, features));
+    }
+    automata = this->replicas[0]->numAutomata();
+    segment.assign((size_t)num_replicas * automata, 0);
+    reconciled.assign(automata, 0);
+
+    // 모든 복제본이 같은 초기 상태에서 시작
+    this->replicas[0]->exportStates(reconciled.data());
+    for (int r = 1; r < num_replicas; r++) {
+        this->replicas[r]->importStates(reconciled.data());
+    }
+}
+
+ReplicaTrainer::~ReplicaTrainer() {
+    for (auto* replica : replicas) {
+        delete replica;
+    }
+}
+
+// 한 번의 동기화: 기록 → 구간별 조정 → 가져오기 (풀 호출이 끝나야 다음 단계로 넘어가므로 장벽이 필요 없음)
+void ReplicaTrainer::synchronize() {
+    ThreadPool& pool = ThreadPool::shared();
+    pool.run(num_replicas, [&](int r) {
+        replicas[r]->exportStates(segment.data() + (size_t)r * automata);
+    });
+    pool.parallelFor(0, automata, [&](int begin, int end) {
+        reconcile(begin, end);
+    });
+    pool.run(num_replicas, [&](int r) {
+        replicas[r]->importStates(reconciled.data());
+    });
+}
+
+void ReplicaTrainer::reconcile(int begin, int end) {
+    int include_state = 1 << (replicas[0]->machine(0).stateBits() - 1);
+    for (int a = begin; a < end; a++) {
+        if (mode == SYNC_AVERAGE) {
+            int sum = 0;
+            for (int r = 0; r < num_replicas; r++) {
+                sum += segment[(size_t)r * automata + a];
+            }
+            reconciled[a] = (sum + num_replicas / 2) / num_replicas;
+        } else {
+            // 결정 비트는 상태값의 중간(2^(state_bits-1) 이상 → Include)과 같으므로 합계로 다수결을 계산
+            int include_sum = 0, include_count = 0, exclude_sum = 0;
+            for (int r = 0; r < num_replicas; r++) {
+                int state = segment[(size_t)r * automata + a];
+                if (state >= include_state) {
+                    include_sum += state;
+                    include_count++;
+                } else {
+                    exclude_sum += state;
+                }
+            }
+            int exclude_count = num_replicas - include_count;
+            if (include_count > exclude_count)
+                reconciled[a] = (include_sum + include_count / 2) / include_count;
+            else
+                reconciled[a] = (exclude_sum + exclude_count / 2) / exclude_count;
+        }
+    }
+}
+
+vector<ReplicaTrainer::Report> ReplicaTrainer::fit(const vector<vector<unsigned int>>& X, const vector<int>& y,
+                                                   int epochs,
+                                                   const vector<vector<unsigned int>>& X_val,
+                                                   const vector<int>& y_val) {
+    ThreadPool& pool = ThreadPool::shared();
+    vector<Report> reports;
+    int num_examples = X.size();
+    // 모든 복제본이 같은 횟수로 동기화하도록 가장 큰 샤드 크기 기준으로 반복
+    int shard_size = (num_examples + num_replicas - 1) / num_replicas;
+    int interval = sync_interval > 0 ? sync_interval : shard_size;
+
+    // 복제본별 scratch는 학습 전체에서 재사용 (순서대로 만들어 난수 스트림을 정함)
+    vector<TsetlinMachine::Scratch> scratches;
+    for (int r = 0; r < num_replicas; r++) {
+        scratches.push_back(replicas[r]->createScratch());
+    }
+
+    for (int epoch = 0; epoch < epochs; epoch++) {
+        double sync_seconds = 0;
+        int syncs = 0;
+        auto start = steady_clock::now();
+
+        // 동기화 구간마다: 복제본마다 작업 하나로 자기 샤드의 [first, last) 단계를 학습한 뒤 동기화
+        for (int first = 0; first < shard_size; first += interval) {
+            int last = min(first + interval, shard_size);
+            pool.run(num_replicas, [&](int r) {
+                for (int step = first; step < last; step++) {
+                    int i = step * num_replicas + r;
+                    if (i < num_examples)
+                        replicas[r]->train(X[i], y[i], scratches[r]);
+                }
+            });
+            if (num_replicas > 1) {
+                auto sync_start = steady_clock::now();
+                synchronize();
+                sync_seconds += duration<double>(steady_clock::now() - sync_start).count();
+                syncs++;
+            }
+        }
+
+        Report report;
+        report.epoch = epoch + 1;
+        report.train_seconds = duration<double>(steady_clock::now() - start).count();
+        report.sync_seconds = sync_seconds;
+        report.syncs = syncs;
+        report.accuracy = X_val.empty() ? 0.0 : replicas[0]->evaluate(X_val, y_val);
+        reports.push_back(report);
+    }
+    return reports;
+}
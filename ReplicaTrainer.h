@@ -0,0 +1,63 @@
+#ifndef TSETLIN_MACHINE_REPLICATRAINER_H
+#define TSETLIN_MACHINE_REPLICATRAINER_H
+
+#include "MultiClassTsetlin.h"
+#include <vector>
+using namespace std;
+
+// 데이터 병렬 학습: K개의 MultipleClassTsetlin 복제본이 각자의 데이터 샤드(i % K == r)로
+// 공용 풀(ThreadPool::shared())의 작업으로 학습하고, sync_interval개 예제마다 공유 상태 세그먼트를 통해 automaton 상태를 조정.
+// 동기화 한 번은 풀 호출 단계로 나뉘므로 작업 사이의 장벽이 없음 (풀이 복제본 수보다 작아도 교착되지 않음)
+//  – 각 복제본은 상태값(비트 평면에서 복원한 카운터)을 세그먼트의 자기 슬롯에 기록
+//  – 모든 automaton을 구간으로 나누어 병렬로 조정값을 계산
+//  – 모든 복제본이 조정된 상태를 다시 비트 평면으로 가져옴
+class ReplicaTrainer {
+public:
+    enum SyncMode {
+        SYNC_AVERAGE,  // 상태값의 평균 (반올림)
+        SYNC_MAJORITY  // Include/Exclude 다수결 후, 다수 쪽 복제본들의 상태값 평균
+    };
+
+    // 정확도 대비 동기화 비용 보고
+    struct Report {
+        int epoch;
+        double accuracy;       // 검증 데이터 정확도 (복제본 0 기준)
+        double train_seconds;  // epoch 전체 시간
+        double sync_seconds;   // 그 중 동기화 단계에 쓴 시간
+        int syncs;             // epoch 중 동기화 횟수
+    };
+
+    // state_bits, features: 복제본 MultipleClassTsetlin의 비트 평면 수와 입력 특성 수
+    ReplicaTrainer(int replicas, int num_classes, int clauses, int threshold, double s, int state_bits, int features,
+                   int sync_interval, SyncMode mode = SYNC_AVERAGE);
+    ~ReplicaTrainer();
+
+    // epochs번 학습하며 매 epoch 끝의 검증 정확도와 동기화 비용을 epoch마다 하나씩 반환
+    vector<Report> fit(const vector<vector<unsigned int>>& X, const vector<int>& y, int epochs,
+                       const vector<vector<unsigned int>>& X_val, const vector<int>& y_val);
+
+    // 조정이 끝난 모델 (fit 종료 시 모든 복제본이 같은 상태)
+    MultipleClassTsetlin& model() { return *replicas[0]; }
+    const MultipleClassTsetlin& replica(int r) const { return *replicas[r]; }
+    int numReplicas() const { return num_replicas; }
+
+    void setSyncInterval(int interval) { sync_interval = interval; }
+
+private:
+    int num_replicas;
+    int sync_interval;
+    SyncMode mode;
+    vector<MultipleClassTsetlin*> replicas;
+
+    // 공유 상태 세그먼트: [복제본][automaton] 상태값과 조정 결과
+    int automata;
+    vector<int> segment;
+    vector<int> reconciled;
+
+    // 내부: 한 번의 동기화 (기록 → 구간별 조정 → 가져오기, 단계마다 풀 호출 하나)
+    void synchronize();
+    // 내부: [begin, end) automaton의 조정값을 세그먼트에서 계산
+    void reconcile(int begin, int end);
+};
+
+#endif //TSETLIN_MACHINE_REPLICATRAINER_H
@@ -0,0 +1,193 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cstdlib>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+using namespace std;
+
+namespace {
+
+// 현재 스레드가 작업자로 속한 풀과 그 deque 번호
+thread_local const ThreadPool* current_pool = nullptr;
+thread_local int current_queue = 0;
+
+// 환경 변수의 양의 정수 값 (없거나 잘못된 값이면 fallback)
+int env_int(const char* name, int fallback) {
+    const char* value = getenv(name);
+    if (value == nullptr || *value == '\0')
+        return fallback;
+    char* end;
+    long parsed = strtol(value, &end, 10);
+    if (*end != '\0' || parsed <= 0 || parsed > 4096)
+        return fallback;
+    return (int)parsed;
+}
+
+void pin_current_thread(int cpu) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)cpu;
+#endif
+}
+
+} // namespace
+
+ThreadPool::ThreadPool(int num_threads, bool pin_threads)
+        : pin(pin_threads), queued(0), stopping(false) {
+    int count = max(1, num_threads);
+    for (int i = 0; i < count; i++) {
+        queues.emplace_back(new Queue());
+    }
+    for (int i = 1; i < count; i++) {
+        workers.emplace_back(&ThreadPool::worker_loop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> lock(mtx);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool(env_int("TM_THREADS", max(1u, thread::hardware_concurrency())),
+                           env_int("TM_AFFINITY", 0) == 1);
+    return pool;
+}
+
+int ThreadPool::queue_index() const {
+    return current_pool == this ? current_queue : 0;
+}
+
+bool ThreadPool::take(int index, const Batch* batch, Task& task) {
+    int count = (int)queues.size();
+    for (int n = 0; n < count; n++) {
+        Queue& queue = *queues[(index + n) % count];
+        lock_guard<mutex> lock(queue.mtx);
+        if (queue.tasks.empty())
+            continue;
+        // 자기 deque는 뒤에서 (최근에 넣은 구간), 다른 deque는 앞에서 훔침
+        bool own = n == 0;
+        if (batch == nullptr) {
+            if (own) {
+                task = queue.tasks.back();
+                queue.tasks.pop_back();
+            } else {
+                task = queue.tasks.front();
+                queue.tasks.pop_front();
+            }
+            queued.fetch_sub(1);
+            return true;
+        }
+        if (own) {
+            for (auto it = queue.tasks.rbegin(); it != queue.tasks.rend(); ++it) {
+                if (it->batch == batch) {
+                    task = *it;
+                    queue.tasks.erase(next(it).base());
+                    queued.fetch_sub(1);
+                    return true;
+                }
+            }
+        } else {
+            for (auto it = queue.tasks.begin(); it != queue.tasks.end(); ++it) {
+                if (it->batch == batch) {
+                    task = *it;
+                    queue.tasks.erase(it);
+                    queued.fetch_sub(1);
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+void ThreadPool::execute(const Task& task) {
+    Batch* batch = task.batch;
+    (*batch->body)(task.begin, task.end);
+    // 마지막 구간이면 호출 스레드를 깨움 (이후 batch는 호출 스레드의 스택에서 사라질 수 있음)
+    if (batch->remaining.fetch_sub(1) == 1) {
+        lock_guard<mutex> lock(mtx);
+        finished.notify_all();
+    }
+}
+
+void ThreadPool::parallelFor(int begin, int end, const function<void(int, int)>& body, int grain) {
+    int n = end - begin;
+    if (n <= 0)
+        return;
+    if (grain <= 0)
+        grain = max(1, n / (size() * 4));
+    int ranges = (n + grain - 1) / grain;
+    // 작업자가 없거나 구간이 하나뿐이면 호출 스레드에서 바로 실행
+    if (workers.empty() || ranges == 1) {
+        body(begin, end);
+        return;
+    }
+
+    Batch batch;
+    batch.body = &body;
+    batch.remaining.store(ranges);
+    // 구간을 자기 deque부터 돌아가며 나눠 넣음
+    int own = queue_index();
+    int count = (int)queues.size();
+    for (int r = 0; r < ranges; r++) {
+        Task task{&batch, begin + r * grain, min(end, begin + (r + 1) * grain)};
+        Queue& queue = *queues[(own + r) % count];
+        lock_guard<mutex> lock(queue.mtx);
+        queue.tasks.push_back(task);
+    }
+    {
+        lock_guard<mutex> lock(mtx);
+        queued.fetch_add(ranges);
+    }
+    wake.notify_all();
+
+    // 자기 호출의 구간을 처리하며 기다림 (남은 구간이 없으면 다른 스레드가 끝내기를 기다림)
+    while (batch.remaining.load() > 0) {
+        Task task;
+        if (take(own, &batch, task)) {
+            execute(task);
+            continue;
+        }
+        unique_lock<mutex> lock(mtx);
+        finished.wait(lock, [&]() { return batch.remaining.load() == 0; });
+    }
+}
+
+void ThreadPool::run(int tasks, const function<void(int)>& task) {
+    parallelFor(0, tasks, [&](int first, int last) {
+        for (int i = first; i < last; i++) {
+            task(i);
+        }
+    }, 1);
+}
+
+void ThreadPool::worker_loop(int index) {
+    current_pool = this;
+    current_queue = index;
+    if (pin)
+        pin_current_thread(index % max(1u, thread::hardware_concurrency()));
+    while (true) {
+        Task task;
+        if (take(index, nullptr, task)) {
+            execute(task);
+            continue;
+        }
+        unique_lock<mutex> lock(mtx);
+        wake.wait(lock, [this]() { return stopping || queued.load() > 0; });
+        if (stopping && queued.load() <= 0)
+            return;
+    }
+}
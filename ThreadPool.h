@@ -0,0 +1,77 @@
+#ifndef TSETLIN_MACHINE_THREADPOOL_H
+#define TSETLIN_MACHINE_THREADPOOL_H
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+using namespace std;
+
+// 상주 작업 훔치기(work-stealing) 풀: 작업자 스레드를 한 번만 만들고, 호출마다 구간을 나눠 스레드별 deque에 넣음.
+// 각 스레드는 자기 deque의 뒤에서 꺼내고, 비면 다른 deque의 앞에서 훔쳐 옴.
+//  – 호출 스레드도 자기 호출의 작업을 처리하며 기다리므로 작업 안에서 다시 호출해도 교착되지 않음
+//  – 여러 스레드가 동시에 호출해도 되며, 각 호출은 자기 작업이 모두 끝나면 반환
+//  – shared(): 라이브러리 전체가 함께 쓰는 풀 (TM_THREADS, TM_AFFINITY 환경 변수로 설정)
+class ThreadPool {
+public:
+    // num_threads: 호출 스레드를 포함한 총 병렬도 (작업자 스레드는 num_threads-1개).
+    // pin_threads: 작업자 i를 CPU i % (CPU 수)에 고정 (Linux에서만, 실패하면 고정 없이 실행)
+    explicit ThreadPool(int num_threads, bool pin_threads = false);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // 라이브러리 공용 풀 (처음 호출할 때 생성).
+    // TM_THREADS: 총 병렬도 (없거나 잘못된 값이면 하드웨어 스레드 수), TM_AFFINITY=1: 작업자를 CPU에 고정
+    static ThreadPool& shared();
+
+    // [begin, end)를 grain개 이하씩의 구간으로 나눠 body(구간 시작, 구간 끝)를 실행하고 모두 끝날 때까지 대기.
+    // grain이 0 이하이면 스레드당 4개 정도의 구간이 되도록 정함
+    void parallelFor(int begin, int end, const function<void(int, int)>& body, int grain = 0);
+
+    // 0..tasks-1번 작업을 하나씩 실행하고 모두 끝날 때까지 대기 (parallelFor의 grain 1)
+    void run(int tasks, const function<void(int)>& task);
+
+    // 호출 스레드를 포함한 총 병렬도
+    int size() const { return (int)workers.size() + 1; }
+    bool pinned() const { return pin; }
+
+private:
+    // 한 번의 parallelFor 호출: 남은 구간 수가 0이 되면 호출 스레드가 반환
+    struct Batch {
+        const function<void(int, int)>* body;
+        atomic<int> remaining;
+    };
+    struct Task {
+        Batch* batch;
+        int begin, end;
+    };
+    // 스레드별 deque (0번은 풀 밖의 호출 스레드들이 함께 사용)
+    struct Queue {
+        mutex mtx;
+        deque<Task> tasks;
+    };
+
+    vector<thread> workers;
+    vector<unique_ptr<Queue>> queues;
+    bool pin;
+    mutex mtx;
+    condition_variable wake;      // 새 작업 알림 (작업자)
+    condition_variable finished;  // 호출의 마지막 구간 완료 알림 (호출 스레드)
+    atomic<int> queued;           // 모든 deque에 남은 작업 수
+    bool stopping;
+
+    void worker_loop(int index);
+    // 내부: index번 deque의 뒤, 없으면 다른 deque의 앞에서 작업을 꺼냄 (batch가 nullptr가 아니면 그 호출의 작업만)
+    bool take(int index, const Batch* batch, Task& task);
+    void execute(const Task& task);
+    // 내부: 이 풀의 작업자이면 그 deque 번호, 아니면 0
+    int queue_index() const;
+};
+
+#endif //TSETLIN_MACHINE_THREADPOOL_H
@@ -1,153 +1,579 @@
 #include "TsetlinMachine.h"
+#include "ThreadPool.h"
+#include "BitPlaneKernels.h"
 #include <cstdlib>
 #include <ctime>
 #include <cstring>
 #include <cmath>
 #include <climits>
 #include <iostream>
+#include <atomic>
 using namespace std;
 
 // 생성자: 절의 수, 투표 임계값, s 파라미터를 받아 내부 벡터들을 초기화합니다.
-TsetlinMachine::TsetlinMachine(int clauses, int threshold, double s)
-        : clauses(clauses), threshold(threshold), s(s) {
-    // INT_SIZE, FEATURES 등은 상수로 정의됨
-    la_chunks = (NUM_LITERALS + INT_SIZE - 1) / INT_SIZE; // 예: (2*784)/32
+TsetlinMachine::TsetlinMachine(int clauses, int threshold, double s, int state_bits, int features)
+        : clauses(clauses), threshold(threshold), s(s),
+          features(features), num_literals(2 * features),
+          state_bits(min(max(state_bits, MIN_STATE_BITS), MAX_STATE_BITS)),
+          pool(nullptr), shards(1), absorbing(false), absorb_lower(-1) {
+    absorb_upper = 1 << this->state_bits;
+    select_kernels();
+
+    // INT_SIZE는 상수, 리터럴 수는 특성 수의 두 배
+    la_chunks = (num_literals + INT_SIZE - 1) / INT_SIZE; // 예: (2*784)/32
     clause_chunks = (clauses + INT_SIZE - 1) / INT_SIZE;
 
-    // 3차원 벡터 ta_state[clauses][la_chunks][STATE_BITS] 초기화, initialize
-    ta_state.resize(clauses, vector<vector<unsigned int>>(la_chunks, vector<unsigned int>(STATE_BITS, 0)));
+    // ta_state[clauses][state_bits][la_chunks] 초기화, initialize
+    ta_state.assign((size_t)clauses * this->state_bits * la_chunks, 0);
     for (int j = 0; j < clauses; j++) {
         for (int k = 0; k < la_chunks; k++) {
-            // 초기: 하위 STATE_BITS-1 비트는 모두 1 (즉, ~0), 마지막 비트는 0 → Exclude 상태
-            for (int b = 0; b < STATE_BITS - 1; b++) {
-                ta_state[j][k][b] = ~0u; // 모든 비트를 1로
+            // 초기: 하위 state_bits-1 비트는 모두 1 (즉, ~0), 마지막 비트는 0 → Exclude 상태
+            for (int b = 0; b < this->state_bits - 1; b++) {
+                plane(j, b, k) = ~0u; // 모든 비트를 1로
             }
-            ta_state[j][k][STATE_BITS - 1] = 0;
+            plane(j, this->state_bits - 1, k) = 0;
         }
     }
 
-    // 절 출력 및 피드백 벡터 초기화 (모두 0)
-    clause_output.assign(clause_chunks, 0);
-    feedback_to_la.assign(la_chunks, 0);
-    feedback_to_clauses.assign(clause_chunks, 0);
+    // dirty 비트맵: 아직 한 번도 평가되지 않았으므로 모든 절을 dirty로 시작
+    dirty_clauses.assign(clause_chunks, 0);
+    for (int j = 0; j < clauses; j++) {
+        dirty_clauses[j / INT_SIZE] |= (1u << (j % INT_SIZE));
+    }
+
+    // 처음에는 모든 automata가 Exclude이므로 Include 수는 0, 리터럴 예산은 제한 없음
+    include_count.assign(clauses, 0);
+    literal_budget = num_literals;
+    decision_flips = 0;
+
+    // 흡수 상태 비트맵 초기화: 처음에는 모든 automata가 살아있음
+    int rem = num_literals % INT_SIZE;
+    last_chunk_filter = (rem == 0) ? ~0u : ((1u << rem) - 1);
+    live_chunk_words = (la_chunks + INT_SIZE - 1) / INT_SIZE;
+    // Type I 스트림 크기: 평균적으로 리터럴의 1/s를 활성화 (update마다 실수 연산을 하지 않도록 미리 계산)
+    stream_literals = min(max((int)round(num_literals / s), 0), num_literals);
+    // 미니배치 증감은 상태 범위보다 넓을 필요가 없음
+    delta_bits = min(this->state_bits, MAX_DELTA_BITS);
+    live.assign(clauses, vector<unsigned int>(la_chunks, ~0u));
+    live_chunks.assign(clauses, vector<unsigned int>(live_chunk_words, 0));
+    for (int j = 0; j < clauses; j++) {
+        live[j][la_chunks - 1] = last_chunk_filter;
+        for (int k = 0; k < la_chunks; k++) {
+            live_chunks[j][k / INT_SIZE] |= (1u << (k % INT_SIZE));
+        }
+    }
 
     // 랜덤 seed 초기화
     srand((unsigned) time(0));
+
+    // 절 출력 및 피드백 벡터 초기화 (모두 0)
+    local = createScratch();
+}
+
+// 이 machine의 절/청크 수에 맞는 scratch 생성
+// 난수 상태는 rand()로 seed하고, 같은 seed로 만든 scratch끼리 겹치지 않도록 생성 순번을 섞음
+TsetlinMachine::Scratch TsetlinMachine::createScratch() const {
+    static atomic<uint64_t> scratch_count(0);
+    Scratch scratch;
+    scratch.clause_output.assign(clause_chunks, 0);
+    scratch.feedback_to_la.assign(la_chunks, 0);
+    scratch.feedback_to_clauses.assign(clause_chunks, 0);
+    scratch.rng = (((uint64_t)rand() << 32) ^ (uint64_t)rand()) +
+                  (++scratch_count) * 0x9E3779B97F4A7C15ULL;
+    return scratch;
 }
 
 // 내부: 피드백용 random stream 초기화
-//  – 모든 피드백 비트를 0으로 초기화한 후, 2*FEATURES 중 약 1/S 비트를 활성화합니다.
-void TsetlinMachine::initialize_random_streams() {
-    // feedback_to_la를 0으로 초기화
-    for (int k = 0; k < la_chunks; k++) {
-        feedback_to_la[k] = 0;
-    }
-    int n = NUM_LITERALS;
-    double p = 1.0 / s;
-    // 평균적으로 활성화될 개수
-    int active = int(round(n * p));
-    if (active > n) active = n;
-    if (active < 0) active = 0;
-    while (active--) {
-        int f = rand() % n;
-        int chunk = f / INT_SIZE;
-        int pos = f % INT_SIZE;
-        // 이미 활성화되어 있으면 재선택
-        while (feedback_to_la[chunk] & (1u << pos)) {
-            f = rand() % n;
-            chunk = f / INT_SIZE;
-            pos = f % INT_SIZE;
-        }
-        feedback_to_la[chunk] |= (1u << pos);
-    }
+//  – 모든 피드백 비트를 0으로 초기화한 후, 2*features 중 약 1/S 비트를 활성화합니다.
+void TsetlinMachine::initialize_random_streams(Scratch& scratch) {
+    draw_stream(scratch.feedback_to_la.data(), la_chunks, num_literals, stream_literals, scratch.rng);
 }
 
 
-// 내부: 선택된 automata의 상태를 증가시키는 함수 (비트 단위 캐리 연산)
-void TsetlinMachine::inc(int clause, int chunk, unsigned int active) {
+// 내부: 선택된 automata의 상태를 증가시키는 캐리 체인 (비트 단위 캐리 연산)
+template <int BITS>
+unsigned int TsetlinMachine::inc_planes(unsigned int* planes, int stride, unsigned int active) {
     unsigned int carry = active;
-    for (int b = 0; b < STATE_BITS; b++) {
+    unsigned int flipped = 0;
+#pragma GCC unroll 16
+    for (int b = 0; b < BITS; b++) {
         if (carry == 0)
-            break;
-        unsigned int carry_next = ta_state[clause][chunk][b] & carry;  // overflow 비트 계산
-        ta_state[clause][chunk][b] ^= carry;                           // XOR로 더함
+            return flipped;
+        unsigned int plane = load_word(planes[b * stride]);
+        unsigned int carry_next = plane & carry;          // overflow 비트 계산
+        store_word(planes[b * stride], plane ^ carry);    // XOR로 더함
+        // 결정 비트가 0 → 1 (Exclude → Include)로 바뀐 automata
+        if (b == BITS - 1)
+            flipped = carry & ~plane;
         carry = carry_next;
     }
     if (carry > 0) {
         // overflow가 남으면 모든 비트에 해당 carry를 OR
-        for (int b = 0; b < STATE_BITS; b++) {
-            ta_state[clause][chunk][b] |= carry;
+#pragma GCC unroll 16
+        for (int b = 0; b < BITS; b++) {
+            store_word(planes[b * stride], load_word(planes[b * stride]) | carry);
         }
     }
+    return flipped;
 }
 
-// 내부: 선택된 automata의 상태를 감소시키는 함수
-void TsetlinMachine::dec(int clause, int chunk, unsigned int active) {
+// 내부: 선택된 automata의 상태를 감소시키는 빌림(borrow) 체인
+template <int BITS>
+unsigned int TsetlinMachine::dec_planes(unsigned int* planes, int stride, unsigned int active) {
     unsigned int carry = active;
-    for (int b = 0; b < STATE_BITS; b++) {
+    unsigned int flipped = 0;
+#pragma GCC unroll 16
+    for (int b = 0; b < BITS; b++) {
         if (carry == 0)
-            break;
-        unsigned int carry_next = (~ta_state[clause][chunk][b]) & carry;
-        ta_state[clause][chunk][b] ^= carry;
+            return flipped;
+        unsigned int plane = load_word(planes[b * stride]);
+        unsigned int carry_next = (~plane) & carry;
+        store_word(planes[b * stride], plane ^ carry);
+        // 결정 비트가 1 → 0 (Include → Exclude)
+        if (b == BITS - 1)
+            flipped = carry & plane;
         carry = carry_next;
     }
     if (carry > 0) {
-        for (int b = 0; b < STATE_BITS; b++) {
-            ta_state[clause][chunk][b] &= ~carry;
+#pragma GCC unroll 16
+        for (int b = 0; b < BITS; b++) {
+            store_word(planes[b * stride], load_word(planes[b * stride]) & ~carry);
         }
     }
+    return flipped;
 }
 
-// 내부: 각 절의 출력 계산
-// predict가 true이면 예측 모드(모든 절이 모두 Exclude인 경우 출력 0으로 강제),
-// false이면 업데이트 모드로 계산합니다.
-void TsetlinMachine::calculate_clause_output(const vector<unsigned int>& Xi, bool predict) {
-    // 먼저 clause_output를 0으로 초기화
-    for (int i = 0; i < clause_chunks; i++) {
-        clause_output[i] = 0;
+// 청크 8개(256비트)를 한 벡터로 처리 (BitPlaneKernels.h의 PlaneVector)
+typedef PlaneVector<unsigned int>::type ChunkVector;
+static const int VECTOR_CHUNKS = PlaneVector<unsigned int>::LANES;
+static const int MAX_DELTA_PLANES = TsetlinMachine::MAX_DELTA_BITS;
+
+// 0이 아닌 비트가 하나라도 있는지 (벡터는 모든 lane을 OR)
+static inline bool vector_any(unsigned int word) {
+    return word != 0;
+}
+static inline bool vector_any(ChunkVector vector) {
+    unsigned int any = 0;
+    for (int l = 0; l < VECTOR_CHUNKS; l++) {
+        any |= vector[l];
+    }
+    return any != 0;
+}
+
+template <int BITS, int KIND>
+void TsetlinMachine::absorbing_feedback_planes(unsigned int* planes, int chunks, const unsigned int* Xi,
+                                               const unsigned int* stream, unsigned int* live,
+                                               unsigned int* live_chunks, int lower, int upper,
+                                               int& included, int& excluded) {
+    included = 0;
+    excluded = 0;
+    // live는 마지막 청크의 남는 비트를 포함하지 않으므로 필터 없이 모든 청크를 벡터로 처리
+    int vector_end = chunks / VECTOR_CHUNKS * VECTOR_CHUNKS;
+    for (int k = 0; k < vector_end; k += VECTOR_CHUNKS) {
+        ChunkVector mask;
+        memcpy(&mask, live + k, sizeof(mask));
+        // 모두 동결된 청크들은 평면을 읽지 않고 건너뜀
+        if (!vector_any(mask))
+            continue;
+        ChunkVector to_include, to_exclude, frozen;
+        feedback_block<BITS, KIND, true>(planes + k, chunks, Xi + k, stream + k, mask, lower, upper,
+                                         to_include, to_exclude, frozen);
+        if (vector_any(to_include | to_exclude)) {
+            for (int l = 0; l < VECTOR_CHUNKS; l++) {
+                included += __builtin_popcount(to_include[l]);
+                excluded += __builtin_popcount(to_exclude[l]);
+            }
+        }
+        if (vector_any(frozen)) {
+            mask &= ~frozen;
+            memcpy(live + k, &mask, sizeof(mask));
+            for (int l = 0; l < VECTOR_CHUNKS; l++) {
+                if (mask[l] == 0)
+                    live_chunks[(k + l) / INT_SIZE] &= ~(1u << ((k + l) % INT_SIZE));
+            }
+        }
     }
+    for (int k = vector_end; k < chunks; k++) {
+        if (live[k] == 0)
+            continue;
+        unsigned int to_include, to_exclude, frozen;
+        feedback_block<BITS, KIND, true>(planes + k, chunks, Xi + k, stream + k, live[k], lower, upper,
+                                         to_include, to_exclude, frozen);
+        included += __builtin_popcount(to_include);
+        excluded += __builtin_popcount(to_exclude);
+        if (frozen) {
+            live[k] &= ~frozen;
+            if (live[k] == 0)
+                live_chunks[k / INT_SIZE] &= ~(1u << (k % INT_SIZE));
+        }
+    }
+}
 
-    // 마지막 청크에 사용할 필터: 마지막 청크에 유효한 비트 수(32보다 작을 수 있음)
-    unsigned int filter;
-    int rem = NUM_LITERALS % INT_SIZE;
-    if (rem == 0) filter = ~0u; else filter = ((1u << rem) - 1);
+// 미니배치 누적 블록: 증감 평면 D개를 레지스터로 읽어 inc는 +1, dec는 -1 (2의 보수, 포화).
+// 최댓값(0111...)에서의 +1과 최솟값(1000...)에서의 -1은 미리 제외하고, 캐리와 빌림을 같은 순회에서 계산
+template <int D, int KIND, typename T>
+static inline void delta_block(unsigned int* delta, int stride, const unsigned int* Xi, const unsigned int* stream,
+                               const unsigned int* top, const unsigned int* live) {
+    T w[D];
+#pragma GCC unroll 8
+    for (int b = 0; b < D; b++) {
+        memcpy(&w[b], delta + b * stride, sizeof(T));
+    }
+    T x, f, t, m;
+    memcpy(&x, Xi, sizeof(T));
+    memcpy(&f, stream, sizeof(T));
+    memcpy(&t, top, sizeof(T));
+    memcpy(&m, live, sizeof(T));
+    T zero = x ^ x;
+    T inc, dec;
+    feedback_masks(KIND, x, f, t, m, inc, dec);
+    T sign = w[D - 1];
+    T rest_ones = ~zero, rest_zeros = ~zero;
+#pragma GCC unroll 8
+    for (int b = 0; b < D - 1; b++) {
+        rest_ones &= w[b];
+        rest_zeros &= ~w[b];
+    }
+    T carry = inc & ~(~sign & rest_ones);
+    T borrow = dec & ~(sign & rest_zeros);
+#pragma GCC unroll 8
+    for (int b = 0; b < D; b++) {
+        T plane = w[b];
+        w[b] = plane ^ carry ^ borrow;
+        carry &= plane;
+        borrow &= ~plane;
+        memcpy(delta + b * stride, &w[b], sizeof(T));
+    }
+}
 
-    // 각 절 j에 대해 출력 계산
-    for (int j = 0; j < clauses; j++) {
-        bool output = true;
-        bool all_exclude = true;
-        // k = 0 ~ la_chunks-2
-        for (int k = 0; k < la_chunks - 1; k++) {
-            // ta_state[j][k][STATE_BITS-1]는 automata의 결정 비트(Include 여부)
-            //j번째 clause의 k번 째 literal의 state bit
-            // 절이 활성화되려면, ta_state의 결정 비트가 설정된 모든 자리에서 입력 Xi의 해당 비트가 1이어야 함.
-    /*        Clause Output이 1이 되는 조건은 다음과 같습니다:
-
-            해당 Clause에 포함(Include)된 리터럴들만 고려.
-            이 리터럴들이 입력 데이터(Xi)와 일치하면 Clause Output은 1.
-            만약 하나라도 불일치하면 Clause Output은 0 */
-            if ((ta_state[j][k][STATE_BITS - 1] & Xi[k]) != ta_state[j][k][STATE_BITS - 1]) {
-                output = false;
-                break;
+template <int D, int KIND>
+void TsetlinMachine::accumulate_planes(unsigned int* delta, int chunks, const unsigned int* Xi,
+                                       const unsigned int* stream, const unsigned int* top,
+                                       const unsigned int* live) {
+    int vector_end = chunks / VECTOR_CHUNKS * VECTOR_CHUNKS;
+    for (int k = 0; k < vector_end; k += VECTOR_CHUNKS) {
+        delta_block<D, KIND, ChunkVector>(delta + k, chunks, Xi + k, stream + k, top + k, live + k);
+    }
+    for (int k = vector_end; k < chunks; k++) {
+        delta_block<D, KIND, unsigned int>(delta + k, chunks, Xi + k, stream + k, top + k, live + k);
+    }
+}
+
+// 미니배치 반영 블록: 상태(부호 없음)와 부호 확장한 증감을 비트 평면 단위 리플 캐리로 더함.
+// 최상위 너머의 캐리가 있고 증감이 양수이면 넘침(모두 1), 캐리가 없고 증감이 음수이면 모자람(모두 0).
+// 증감이 없으면 false (상태를 쓰지 않음)
+template <int BITS, typename T>
+static inline bool delta_apply_block(unsigned int* planes, int stride, unsigned int* delta, int delta_bits,
+                                     T& to_include, T& to_exclude) {
+    T e[MAX_DELTA_PLANES];
+    memcpy(&e[0], delta, sizeof(T));
+    T any = e[0];
+    for (int b = 1; b < delta_bits; b++) {
+        memcpy(&e[b], delta + b * stride, sizeof(T));
+        any |= e[b];
+    }
+    T zero = any ^ any;
+    to_include = zero;
+    to_exclude = zero;
+    if (!vector_any(any))
+        return false;
+    T sign = e[delta_bits - 1];
+    T carry = zero;
+    T w[BITS];
+#pragma GCC unroll 16
+    for (int b = 0; b < BITS; b++) {
+        T s;
+        memcpy(&s, planes + b * stride, sizeof(T));
+        T add = b < delta_bits ? e[b] : sign;
+        w[b] = s ^ add ^ carry;
+        carry = (s & add) | (carry & (s ^ add));
+        if (b == BITS - 1)
+            to_exclude = s;
+    }
+    T over = ~sign & carry;
+    T under = sign & ~carry;
+#pragma GCC unroll 16
+    for (int b = 0; b < BITS; b++) {
+        w[b] = (w[b] | over) & ~under;
+        memcpy(planes + b * stride, &w[b], sizeof(T));
+    }
+    for (int b = 0; b < delta_bits; b++) {
+        memcpy(delta + b * stride, &zero, sizeof(T));
+    }
+    to_include = ~to_exclude & w[BITS - 1];
+    to_exclude = to_exclude & ~w[BITS - 1];
+    return true;
+}
+
+template <int BITS>
+void TsetlinMachine::add_delta_planes(unsigned int* planes, int chunks, unsigned int* delta, int delta_bits,
+                                      int& included, int& excluded) {
+    included = 0;
+    excluded = 0;
+    int vector_end = chunks / VECTOR_CHUNKS * VECTOR_CHUNKS;
+    for (int k = 0; k < vector_end; k += VECTOR_CHUNKS) {
+        ChunkVector to_include, to_exclude;
+        if (!delta_apply_block<BITS>(planes + k, chunks, delta + k, delta_bits, to_include, to_exclude))
+            continue;
+        if (vector_any(to_include | to_exclude)) {
+            for (int l = 0; l < VECTOR_CHUNKS; l++) {
+                included += __builtin_popcount(to_include[l]);
+                excluded += __builtin_popcount(to_exclude[l]);
             }
-            if (ta_state[j][k][STATE_BITS - 1] != 0)
-                all_exclude = false;
         }
-        // 마지막 청크 처리
-        if (output) {
-            if (((ta_state[j][la_chunks - 1][STATE_BITS - 1] & Xi[la_chunks - 1] & filter) !=
-                 (ta_state[j][la_chunks - 1][STATE_BITS - 1] & filter))) {
-                output = false;
+    }
+    for (int k = vector_end; k < chunks; k++) {
+        unsigned int to_include, to_exclude;
+        if (!delta_apply_block<BITS>(planes + k, chunks, delta + k, delta_bits, to_include, to_exclude))
+            continue;
+        included += __builtin_popcount(to_include);
+        excluded += __builtin_popcount(to_exclude);
+    }
+}
+
+#define ACCUMULATE_KERNELS(D) \
+    { &accumulate_planes<D, FEEDBACK_TYPE_II>, &accumulate_planes<D, FEEDBACK_TYPE_I_FIRED>, \
+      &accumulate_planes<D, FEEDBACK_TYPE_I_SILENT> }
+
+#define FEEDBACK_KERNELS(BITS) \
+    { &feedback_planes<BITS, FEEDBACK_TYPE_II, unsigned int>, &feedback_planes<BITS, FEEDBACK_TYPE_I_FIRED, unsigned int>, \
+      &feedback_planes<BITS, FEEDBACK_TYPE_I_SILENT, unsigned int> }
+
+#define ABSORBING_KERNELS(BITS) \
+    { &absorbing_feedback_planes<BITS, FEEDBACK_TYPE_II>, &absorbing_feedback_planes<BITS, FEEDBACK_TYPE_I_FIRED>, \
+      &absorbing_feedback_planes<BITS, FEEDBACK_TYPE_I_SILENT> }
+
+void TsetlinMachine::select_kernels() {
+    static const FeedbackKernel feedback_table[][3] = {
+        FEEDBACK_KERNELS(2), FEEDBACK_KERNELS(3), FEEDBACK_KERNELS(4), FEEDBACK_KERNELS(5), FEEDBACK_KERNELS(6),
+        FEEDBACK_KERNELS(7), FEEDBACK_KERNELS(8), FEEDBACK_KERNELS(9), FEEDBACK_KERNELS(10), FEEDBACK_KERNELS(11),
+        FEEDBACK_KERNELS(12), FEEDBACK_KERNELS(13), FEEDBACK_KERNELS(14), FEEDBACK_KERNELS(15), FEEDBACK_KERNELS(16)
+    };
+    for (int kind = 0; kind < 3; kind++) {
+        feedback_kernels[kind] = feedback_table[state_bits - MIN_STATE_BITS][kind];
+    }
+    static const AbsorbingKernel absorbing_table[][3] = {
+        ABSORBING_KERNELS(2), ABSORBING_KERNELS(3), ABSORBING_KERNELS(4), ABSORBING_KERNELS(5), ABSORBING_KERNELS(6),
+        ABSORBING_KERNELS(7), ABSORBING_KERNELS(8), ABSORBING_KERNELS(9), ABSORBING_KERNELS(10), ABSORBING_KERNELS(11),
+        ABSORBING_KERNELS(12), ABSORBING_KERNELS(13), ABSORBING_KERNELS(14), ABSORBING_KERNELS(15), ABSORBING_KERNELS(16)
+    };
+    for (int kind = 0; kind < 3; kind++) {
+        absorbing_kernels[kind] = absorbing_table[state_bits - MIN_STATE_BITS][kind];
+    }
+    static const DeltaKernel delta_table[] = {
+        &add_delta_planes<2>, &add_delta_planes<3>, &add_delta_planes<4>, &add_delta_planes<5>, &add_delta_planes<6>,
+        &add_delta_planes<7>, &add_delta_planes<8>, &add_delta_planes<9>, &add_delta_planes<10>, &add_delta_planes<11>,
+        &add_delta_planes<12>, &add_delta_planes<13>, &add_delta_planes<14>, &add_delta_planes<15>, &add_delta_planes<16>
+    };
+    delta_kernel = delta_table[state_bits - MIN_STATE_BITS];
+    // 증감 비트 수는 min(state_bits, MAX_DELTA_BITS)
+    static const AccumulateKernel accumulate_table[][3] = {
+        ACCUMULATE_KERNELS(2), ACCUMULATE_KERNELS(3), ACCUMULATE_KERNELS(4), ACCUMULATE_KERNELS(5), ACCUMULATE_KERNELS(6)
+    };
+    for (int kind = 0; kind < 3; kind++) {
+        accumulate_kernels[kind] = accumulate_table[min(state_bits, (int)MAX_DELTA_BITS) - MIN_STATE_BITS][kind];
+    }
+    static const CarryKernel inc_table[] = {
+        &inc_planes<2>, &inc_planes<3>, &inc_planes<4>, &inc_planes<5>, &inc_planes<6>, &inc_planes<7>, &inc_planes<8>, &inc_planes<9>,
+        &inc_planes<10>, &inc_planes<11>, &inc_planes<12>, &inc_planes<13>, &inc_planes<14>, &inc_planes<15>, &inc_planes<16>
+    };
+    static const CarryKernel dec_table[] = {
+        &dec_planes<2>, &dec_planes<3>, &dec_planes<4>, &dec_planes<5>, &dec_planes<6>, &dec_planes<7>, &dec_planes<8>, &dec_planes<9>,
+        &dec_planes<10>, &dec_planes<11>, &dec_planes<12>, &dec_planes<13>, &dec_planes<14>, &dec_planes<15>, &dec_planes<16>
+    };
+    inc_kernel = inc_table[state_bits - MIN_STATE_BITS];
+    dec_kernel = dec_table[state_bits - MIN_STATE_BITS];
+}
+
+// 내부: 선택된 automata의 상태를 증가시키는 함수
+//  – 리터럴 예산이 설정되어 있으면 이번 증가로 Include가 될 후보(결정 비트 0, 하위 비트 모두 1)만큼
+//    include_count를 먼저 예약하고, 예산을 넘는 후보는 active에서 빼서 Exclude 경계에 머물게 함
+void TsetlinMachine::inc(int clause, int chunk, unsigned int active) {
+    int reserved = 0;
+    if (literal_budget < num_literals) {
+        unsigned int candidates = active & ~load_word(plane(clause, state_bits - 1, chunk));
+        for (int b = 0; b < state_bits - 1 && candidates; b++) {
+            candidates &= load_word(plane(clause, b, chunk));
+        }
+        if (candidates) {
+            int wanted = __builtin_popcount(candidates);
+            int before = __atomic_fetch_add(&include_count[clause], wanted, __ATOMIC_RELAXED);
+            reserved = min(max(literal_budget - before, 0), wanted);
+            if (reserved < wanted) {
+                __atomic_fetch_sub(&include_count[clause], wanted - reserved, __ATOMIC_RELAXED);
+                // 낮은 자리부터 reserved개만 남기고 나머지 후보는 이번 증가에서 제외
+                unsigned int refused = candidates;
+                for (int i = 0; i < reserved; i++) {
+                    refused &= refused - 1;
+                }
+                active &= ~refused;
             }
-            if ((ta_state[j][la_chunks - 1][STATE_BITS - 1] & filter) != 0)
-                all_exclude = false;
         }
-        // 예측 모드에서 모든 리터럴이 Exclude이면 절 출력은 0으로 강제
-        if (predict && all_exclude)
-            output = false;
+    }
+    unsigned int flipped = inc_kernel(&plane(clause, 0, chunk), la_chunks, active);
+    // 예약과 실제로 바뀐 수의 차이 보정 (Hogwild에서 다른 스레드가 먼저 바꾼 경우 등)
+    int delta = __builtin_popcount(flipped) - reserved;
+    if (delta != 0)
+        __atomic_fetch_add(&include_count[clause], delta, __ATOMIC_RELAXED);
+    if (flipped) {
+        __atomic_fetch_add(&decision_flips, (long long)__builtin_popcount(flipped), __ATOMIC_RELAXED);
+        mark_dirty(clause);
+    }
+}
+
+// 내부: 선택된 automata의 상태를 감소시키는 함수
+void TsetlinMachine::dec(int clause, int chunk, unsigned int active) {
+    unsigned int flipped = dec_kernel(&plane(clause, 0, chunk), la_chunks, active);
+    if (flipped) {
+        __atomic_fetch_sub(&include_count[clause], __builtin_popcount(flipped), __ATOMIC_RELAXED);
+        __atomic_fetch_add(&decision_flips, (long long)__builtin_popcount(flipped), __ATOMIC_RELAXED);
+        mark_dirty(clause);
+    }
+}
+
+// 내부: 결정 비트 평면에서 절별 Include 수를 다시 셈 (상태를 통째로 기록한 뒤 호출)
+void TsetlinMachine::recount_includes() {
+    include_count.assign(clauses, 0);
+    for (int j = 0; j < clauses; j++) {
+        for (int k = 0; k < la_chunks; k++) {
+            unsigned int include = load_word(plane(j, state_bits - 1, k));
+            if (k == la_chunks - 1)
+                include &= last_chunk_filter;
+            include_count[j] += __builtin_popcount(include);
+        }
+    }
+}
+
+// 리터럴 예산 설정: 0 이하이거나 리터럴 수 이상이면 제한 없음
+void TsetlinMachine::setLiteralBudget(int max_literals) {
+    literal_budget = (max_literals <= 0 || max_literals > num_literals) ? num_literals : max_literals;
+}
+
+// 내부: 절의 결정 비트가 바뀌었음을 기록 (Hogwild에서도 잃지 않도록 원자 OR)
+void TsetlinMachine::mark_dirty(int clause) {
+    __atomic_fetch_or(&dirty_clauses[clause / INT_SIZE], 1u << (clause % INT_SIZE), __ATOMIC_RELAXED);
+}
+
+// dirty 비트맵을 out에 복사하고 비움
+void TsetlinMachine::takeDirtyClauses(vector<unsigned int>& out) {
+    out.resize(clause_chunks);
+    for (int i = 0; i < clause_chunks; i++) {
+        out[i] = __atomic_exchange_n(&dirty_clauses[i], 0u, __ATOMIC_RELAXED);
+    }
+}
+
+// dirty 비트맵 비우기 (스냅샷이 dirty 비트를 가져간 뒤 원본에서 호출)
+void TsetlinMachine::clearDirtyClauses() {
+    for (int i = 0; i < clause_chunks; i++) {
+        store_word(dirty_clauses[i], 0);
+    }
+}
+
+// dirty 비트가 켜진 절만 다시 계산하여 (절 수를 넘는 비트는 무시하므로 ~0u로 전체 계산 가능) 예측 모드 절 출력 비트맵을 갱신
+void TsetlinMachine::refreshClauseOutputs(const unsigned int* Xi, const vector<unsigned int>& dirty,
+                                          vector<unsigned int>& clause_output) const {
+    clause_output.resize(clause_chunks, 0);
+    for (int i = 0; i < clause_chunks; i++) {
+        unsigned int bits = dirty[i];
+        while (bits) {
+            int j = i * INT_SIZE + __builtin_ctz(bits);
+            bits &= bits - 1;
+            if (j >= clauses)
+                break;
+            if (clause_fires(Xi, j, true))
+                clause_output[i] |= (1u << (j % INT_SIZE));
+            else
+                clause_output[i] &= ~(1u << (j % INT_SIZE));
+        }
+    }
+}
+
+// 결정 비트가 켜진 리터럴 번호를 오름차순으로 기록
+void TsetlinMachine::includedLiterals(int clause, vector<int>& out) const {
+    out.clear();
+    for (int k = 0; k < la_chunks; k++) {
+        unsigned int include = load_word(plane(clause, state_bits - 1, k));
+        if (k == la_chunks - 1)
+            include &= last_chunk_filter;
+        while (include) {
+            out.push_back(k * INT_SIZE + __builtin_ctz(include));
+            include &= include - 1;
+        }
+    }
+}
 
+// 절 출력 비트맵으로 클립된 투표 합 계산
+int TsetlinMachine::votes(const vector<unsigned int>& clause_output) const {
+    return sum_up_class_votes(clause_output);
+}
+
+// 내부: 상태값이 value 이상인 automata를 비트마스크로 반환
+//  – 최상위 비트부터 내려오며 "더 큼(gt)"과 "같음(eq)"을 비트 단위로 동시에 계산합니다.
+unsigned int TsetlinMachine::state_at_least(int clause, int chunk, int value) {
+    if (value <= 0) return ~0u;
+    if (value >= (1 << state_bits)) return 0;
+    unsigned int gt = 0;
+    unsigned int eq = ~0u;
+    for (int b = state_bits - 1; b >= 0; b--) {
+        unsigned int plane = load_word(this->plane(clause, b, chunk));
+        if (value & (1 << b)) {
+            eq &= plane;
+        } else {
+            gt |= eq & plane;
+            eq &= ~plane;
+        }
+    }
+    return gt | eq;
+}
+
+// 내부: raised 중 upper 이상, lowered 중 lower 이하가 된 automata를 동결 (live 비트맵에서 제거)
+//  – 상태가 오른 automata만 위 경계에, 내려간 automata만 아래 경계에 닿을 수 있으므로 필요한 비교만 함
+//  – 청크의 모든 automata가 동결되면 live_chunks에서도 제거하여 update에서 청크 전체를 건너뜀
+void TsetlinMachine::absorb(int clause, int chunk, unsigned int raised, unsigned int lowered) {
+    unsigned int frozen = 0;
+    if (raised && absorb_upper < (1 << state_bits))
+        frozen |= raised & state_at_least(clause, chunk, absorb_upper);
+    if (lowered && absorb_lower >= 0)
+        frozen |= lowered & ~state_at_least(clause, chunk, absorb_lower + 1);
+    if (frozen == 0)
+        return;
+    unsigned int remaining = load_word(live[clause][chunk]) & ~frozen;
+    store_word(live[clause][chunk], remaining);
+    if (remaining == 0) {
+        unsigned int& word = live_chunks[clause][chunk / INT_SIZE];
+        store_word(word, load_word(word) & ~(1u << (chunk % INT_SIZE)));
+    }
+}
+
+// 흡수 상태 설정: 경계값을 저장하고, 이미 경계에 도달한 automata를 즉시 동결합니다.
+void TsetlinMachine::setAbsorbingState(int lower, int upper) {
+    absorb_lower = lower;
+    absorb_upper = upper;
+    absorbing = (lower >= 0 || upper < (1 << state_bits));
+    for (int j = 0; j < clauses; j++) {
+        for (int k = 0; k < la_chunks; k++) {
+            live[j][k] = (k == la_chunks - 1) ? last_chunk_filter : ~0u;
+            live_chunks[j][k / INT_SIZE] |= (1u << (k % INT_SIZE));
+            if (absorbing)
+                absorb(j, k, ~0u, ~0u);
+        }
+    }
+}
+
+// 내부: [begin, end) 범위 절의 출력 계산 (begin은 INT_SIZE의 배수 → 샤드끼리 같은 워드를 쓰지 않음)
+// predict가 true이면 예측 모드(모든 절이 모두 Exclude인 경우 출력 0으로 강제),
+// false이면 업데이트 모드로 계산합니다.
+void TsetlinMachine::calculate_clause_output(const unsigned int* Xi, bool predict,
+                                             vector<unsigned int>& clause_output, int begin, int end) const {
+    // 먼저 범위에 해당하는 clause_output 워드를 0으로 초기화
+    for (int i = begin / INT_SIZE; i < (end + INT_SIZE - 1) / INT_SIZE; i++) {
+        clause_output[i] = 0;
+    }
+
+    // 각 절 j에 대해 출력 계산
+    for (int j = begin; j < end; j++) {
         // 절 j의 출력이 true이면, clause_output의 해당 비트를 1로 설정
-        if (output) {
+        if (clause_fires(Xi, j, predict)) {
             int clause_chunk = j / INT_SIZE; //몇 번째 청크
             int bit_pos = j % INT_SIZE; //청크 내에 몇 번째 리터럴
             clause_output[clause_chunk] |= (1u << bit_pos);
@@ -155,46 +581,118 @@ void TsetlinMachine::calculate_clause_output(const vector<unsigned int>& Xi, boo
     }
 }
 
+// 내부: 절 j 하나의 출력 계산.
+// Clause Output이 1이 되는 조건: 해당 Clause에 포함(Include)된 리터럴들이 입력 데이터(Xi)에서 모두 1.
+// 하나라도 불일치하면 0 (마지막 청크는 유효한 비트만 비교)
+bool TsetlinMachine::clause_fires(const unsigned int* Xi, int j, bool predict) const {
+    return clause_fires_planes(&plane(j, state_bits - 1, 0), Xi, la_chunks, last_chunk_filter, predict);
+}
+
 //절들의 투표를 합산하여 클래스 점수를 계산
-// 짝수 절은 +1, 홀수 절은 -1로 투표하며, 결과를 [-threshold, threshold] 범위로 클립함.
-int TsetlinMachine::sum_up_class_votes() {
+// 짝수 절은 +1, 홀수 절은 -1로 투표하며, clip이면 결과를 [-threshold, threshold] 범위로 클립함.
+int TsetlinMachine::sum_up_class_votes(const vector<unsigned int>& clause_output, bool clip) const {
     int class_sum = 0;
     for (int i = 0; i < clause_chunks; i++) {
         // 0x55555555: 0101... (짝수 비트 mask), 0xaaaaaaaa: 1010... (홀수 비트 mask)
         class_sum += __builtin_popcount(clause_output[i] & 0x55555555);
         class_sum -= __builtin_popcount(clause_output[i] & 0xaaaaaaaa);
     }
-    if (class_sum > threshold) class_sum = threshold;
-    if (class_sum < -threshold) class_sum = -threshold;
+    return clip ? clip_votes(class_sum) : class_sum;
+}
+
+// 켜지는 절의 투표를 바로 합산 (짝수 절 +1, 홀수 절 -1). 공유 상태에 쓰지 않으므로 재진입 가능
+int TsetlinMachine::sum_fired_votes(const unsigned int* Xi, int begin, int end) const {
+    int class_sum = 0;
+    for (int j = begin; j < end; j++) {
+        if (clause_fires(Xi, j, true))
+            class_sum += 1 - 2 * (j & 1);
+    }
     return class_sum;
 }
 
+// 피드백 확률 p = (1/(2*threshold))*(threshold + (1-2*target)*class_sum)의 고정소수점 기준값 floor(p * 2^32).
+// class_sum이 클립되어 있으므로 분자는 [0, 2*threshold]이고 기준값은 [0, 2^32] (2^32이면 항상 피드백)
+uint64_t TsetlinMachine::feedbackThreshold(int class_sum, int target, int threshold) {
+    uint64_t numerator = (uint64_t)(threshold + (1 - 2 * target) * class_sum);
+    return (numerator << 32) / (uint64_t)(2 * threshold);
+}
+
 
 //  – 먼저 절의 출력을 계산한 후, 전체 투표(class_sum)를 구하고,
 //    각 절에 대해 Type I / Type II 피드백을 확률적으로 적용.
-void TsetlinMachine::update(const vector<unsigned int>& Xi, int target) {
+//  – 절 샤딩이 설정되어 있으면 절 평가 → 투표 합산 → 피드백을 샤드 단위로 병렬 처리.
+void TsetlinMachine::update(const unsigned int* Xi, int target) {
+    if (pool == nullptr || shards <= 1) {
+        update(Xi, target, local);
+        return;
+    }
+
+    // 1단계: 샤드별 절 출력 계산 (각 샤드는 자기 범위의 clause_output 워드만 기록)
+    pool->run(shards, [&](int shard) {
+        int begin, end;
+        shard_range(shard, begin, end);
+        calculate_clause_output(Xi, false, local.clause_output, begin, end);
+    });
+    // 2단계: 투표 합산 (유일한 직렬 구간)
+    int class_sum = sum_up_class_votes(local.clause_output);
+    uint64_t cutoff = feedbackThreshold(class_sum, target, threshold);
+    // 3단계: 샤드별 피드백 (Type I 스트림과 난수는 샤드 scratch 사용)
+    pool->run(shards, [&](int shard) {
+        int begin, end;
+        shard_range(shard, begin, end);
+        apply_feedback(Xi, target, cutoff, local.clause_output, local.feedback_to_clauses,
+                       shard_scratch[shard], begin, end);
+    });
+}
+
+// scratch 버전: 모든 임시 상태를 scratch에 두고 ta_state는 경쟁 허용 접근으로만 갱신
+void TsetlinMachine::update(const unsigned int* Xi, int target, Scratch& scratch) {
     // UPDATE 모드로 절 출력 계산
-    calculate_clause_output(Xi, false);
-    int class_sum = sum_up_class_votes();
+    calculate_clause_output(Xi, false, scratch.clause_output, 0, clauses);
+    int class_sum = sum_up_class_votes(scratch.clause_output);
 
-    // 피드백 확률 p = (1/(2*threshold))*(threshold + (1-2*target)*class_sum)
-    float p = (1.0f / (threshold * 2)) * (threshold + (1 - 2 * target) * class_sum);
+    uint64_t cutoff = feedbackThreshold(class_sum, target, threshold);
 
+    apply_feedback(Xi, target, cutoff, scratch.clause_output, scratch.feedback_to_clauses, scratch, 0, clauses);
+}
+
+// 내부: [begin, end) 범위의 절마다 32비트 난수 r을 뽑아 r < cutoff이면 feedback_to_clauses에 표시
+void TsetlinMachine::draw_feedback_clauses(uint64_t cutoff, vector<unsigned int>& feedback_to_clauses,
+                                           Scratch& scratch, int begin, int end) {
     // feedback_to_clauses를 0으로 초기화한 후, 각 절에 대해 확률 p로 피드백 적용 여부 결정
-    for (int i = 0; i < clause_chunks; i++) {
+    for (int i = begin / INT_SIZE; i < (end + INT_SIZE - 1) / INT_SIZE; i++) {
         feedback_to_clauses[i] = 0;
     }
-    for (int j = 0; j < clauses; j++) {
+    // 32비트 난수 r에 대해 r < cutoff이면 피드백 (r/2^32 < p와 같음).
+    // 한 워드 분량의 난수를 먼저 뽑고 비교는 분기 없이 마스크로 모음
+    unsigned int draws[INT_SIZE];
+    for (int j = begin; j < end;) {
         int clause_chunk = j / INT_SIZE;
-        int bit_pos = j % INT_SIZE;
-        // 확률 p보다 작으면 해당 절에 피드백 적용 (rand()/(RAND_MAX+1.0) ∈ [0,1))
-        if (((float)rand() / (RAND_MAX + 1.0f)) <= p) {
-            feedback_to_clauses[clause_chunk] |= (1u << bit_pos);
+        int first = j % INT_SIZE;
+        int count = min(end - j, INT_SIZE - first);
+        for (int t = 0; t < count; t++) {
+            draws[t] = scratch.next_random();
+        }
+        unsigned int mask = 0;
+        for (int t = 0; t < count; t++) {
+            mask |= (unsigned int)((uint64_t)draws[t] < cutoff) << (first + t);
         }
+        feedback_to_clauses[clause_chunk] |= mask;
+        j += count;
     }
+}
+
+// 내부: [begin, end) 범위의 절에 기준값 cutoff(확률 * 2^32)로 피드백 대상을 정하고 Type I / Type II 피드백을 적용
+void TsetlinMachine::apply_feedback(const unsigned int* Xi, int target, uint64_t cutoff,
+                                    const vector<unsigned int>& clause_output,
+                                    vector<unsigned int>& feedback_to_clauses,
+                                    Scratch& scratch, int begin, int end) {
+    vector<unsigned int>& feedback_to_la = scratch.feedback_to_la;
+
+    draw_feedback_clauses(cutoff, feedback_to_clauses, scratch, begin, end);
 
     // 각 절에 대해 피드백 적용
-    for (int j = 0; j < clauses; j++) {
+    for (int j = begin; j < end; j++) {
         int clause_chunk = j / INT_SIZE; //몇 번째 clause
         int bit_pos = j % INT_SIZE; //리터럴 위치
         // 피드백이 없는 절은 건너뜀
@@ -204,58 +702,379 @@ void TsetlinMachine::update(const vector<unsigned int>& Xi, int target) {
         // clause polarity: 짝수 절은 positive, 홀수 절은 negative
         // (2*target-1) * (1-2*(j&1)) == -1 → Type II, == 1 → Type I
         int polarity = (1 - 2 * (j & 1)); // 짝수: 1, 홀수: -1, 최하위 비트를 보고 짝수, 홀수 판별
-        if ((2 * target - 1) * polarity == -1) {
-            // Type II 피드백: 절이 활성화되었을 때,
-            // 각 청크에 대해, 입력 Xi의 0인 자리와 automata의 Include 비트(~ta_state[..][STATE_BITS-1])에 대해 inc
-            int out_chunk = j / INT_SIZE;
-            if (clause_output[out_chunk] & (1u << (j % INT_SIZE))) {//literal이 1이라면
-                for (int k = 0; k < la_chunks; k++) {
-                    //둘을 AND한 결과는 입력에서도 0이고, 현재 자동자도 Include 상태(결정 비트 1)가 아닌 리터럴들의 위치를 나타냄.
-                    unsigned int active = (~Xi[k]) & ~(ta_state[j][k][STATE_BITS - 1]);
-                    inc(j, k, active);
-                }
+        int feedback_type = (2 * target - 1) * polarity;
+        bool fired = clause_output[j / INT_SIZE] & (1u << (j % INT_SIZE));
+        // Type II 피드백은 절이 활성화된 경우에만 적용
+        if (feedback_type == -1 && !fired)
+            continue;
+        if (feedback_type == 1) {
+            // Type I 피드백: 먼저, 초기화된 피드백 스트림을 사용
+            initialize_random_streams(scratch);
+        }
+        int kind = feedback_type == -1 ? FEEDBACK_TYPE_II : (fired ? FEEDBACK_TYPE_I_FIRED : FEEDBACK_TYPE_I_SILENT);
+
+        // 리터럴 예산이 없고 Hogwild가 아니면 절 전체를 fused 커널로 한 번에 처리 (청크별 inc/dec 대신).
+        // 흡수 상태를 쓰면 live로 거르고 동결 판정까지 같은 평면 순회에서 하는 커널을 사용.
+        // fused 커널은 벡터 단위 일반 읽기/쓰기이므로 다른 스레드가 같은 절을 갱신하는 Hogwild에서는 쓰지 않음
+        if (!scratch.hogwild && literal_budget >= num_literals) {
+            int included, excluded;
+            if (absorbing)
+                absorbing_kernels[kind](&plane(j, 0, 0), la_chunks, Xi, feedback_to_la.data(), live[j].data(),
+                                        live_chunks[j].data(), absorb_lower, absorb_upper, included, excluded);
+            else
+                feedback_kernels[kind](&plane(j, 0, 0), la_chunks, Xi, feedback_to_la.data(), last_chunk_filter,
+                                       included, excluded);
+            if (included != excluded)
+                __atomic_fetch_add(&include_count[j], included - excluded, __ATOMIC_RELAXED);
+            if (included + excluded > 0) {
+                __atomic_fetch_add(&decision_flips, (long long)(included + excluded), __ATOMIC_RELAXED);
+                mark_dirty(j);
             }
+            continue;
         }
-        else if ((2 * target - 1) * polarity == 1) {
-            // Type I 피드백
-            // 먼저, 초기화된 피드백 스트림을 사용
-            initialize_random_streams();
-            int out_chunk = j / INT_SIZE;
-            if (clause_output[out_chunk] & (1u << (j % INT_SIZE))) {
+
+        // 동결되지 않은 automata가 남아 있는 청크만 순회 (흡수 상태 미사용 시 모든 청크)
+        for (int w = 0; w < live_chunk_words; w++) {
+            unsigned int chunk_bits = load_word(live_chunks[j][w]);
+            while (chunk_bits) {
+                int k = w * INT_SIZE + __builtin_ctz(chunk_bits);
+                chunk_bits &= chunk_bits - 1;
+                unsigned int mask = load_word(live[j][k]);
+                // Type II는 결정 비트 평면(Exclude인 리터럴)이, Type I은 피드백 스트림이 대상을 정함
+                unsigned int top = kind == FEEDBACK_TYPE_II ? load_word(plane(j, state_bits - 1, k)) : 0u;
+                unsigned int raised, lowered;
+                feedback_masks(kind, Xi[k], feedback_to_la[k], top, mask, raised, lowered);
+                if (raised)
+                    inc(j, k, raised);
+                if (lowered)
+                    dec(j, k, lowered);
+
+                // 상태가 바뀐 automata가 있을 때만, 바뀐 방향의 경계 도달 여부를 확인
+                if (absorbing && (raised | lowered))
+                    absorb(j, k, raised, lowered);
+            }
+        }
+    }
+}
+
+// 미니배치 누적: update와 같은 방식으로 피드백 대상 절과 Type I 스트림을 정하되,
+// inc/dec할 automata를 ta_state 대신 증감 버퍼에 ±1로 기록 (흡수 상태로 동결된 automata는 제외)
+void TsetlinMachine::accumulate(const unsigned int* Xi, int target) {
+    if (delta.empty()) {
+        delta.assign((size_t)clauses * delta_bits * la_chunks, 0);
+        delta_clauses.assign(clause_chunks, 0);
+    }
+    calculate_clause_output(Xi, false, local.clause_output, 0, clauses);
+    int class_sum = sum_up_class_votes(local.clause_output);
+    draw_feedback_clauses(feedbackThreshold(class_sum, target, threshold), local.feedback_to_clauses, local, 0, clauses);
+
+    const vector<unsigned int>& stream = local.feedback_to_la;
+    for (int j = 0; j < clauses; j++) {
+        if (!(local.feedback_to_clauses[j / INT_SIZE] & (1u << (j % INT_SIZE))))
+            continue;
+        int feedback_type = (2 * target - 1) * (1 - 2 * (j & 1));
+        bool fired = local.clause_output[j / INT_SIZE] & (1u << (j % INT_SIZE));
+        if (feedback_type == -1 && !fired)
+            continue;
+        if (feedback_type == 1)
+            initialize_random_streams(local);
+        int kind = feedback_type == -1 ? FEEDBACK_TYPE_II : (fired ? FEEDBACK_TYPE_I_FIRED : FEEDBACK_TYPE_I_SILENT);
+        accumulate_kernels[kind](&delta[(size_t)j * delta_bits * la_chunks], la_chunks, Xi, stream.data(),
+                                 &plane(j, state_bits - 1, 0), live[j].data());
+        delta_clauses[j / INT_SIZE] |= 1u << (j % INT_SIZE);
+    }
+}
+
+// 누적된 증감을 절마다 한 번에 반영: 상태 비트 평면을 절당 한 번 읽고 (증감이 있는 청크만) 한 번 씀.
+// 리터럴 예산이 있으면 새로 Include된 automata 중 예산을 넘는 것(높은 리터럴부터)은 이전 상태로 되돌림
+void TsetlinMachine::applyAccumulated() {
+    if (delta.empty())
+        return;
+    bool limited = literal_budget < num_literals;
+    vector<unsigned int> old_planes;
+    for (int i = 0; i < clause_chunks; i++) {
+        unsigned int bits = delta_clauses[i];
+        delta_clauses[i] = 0;
+        while (bits) {
+            int j = i * INT_SIZE + __builtin_ctz(bits);
+            bits &= bits - 1;
+            unsigned int* state = &plane(j, 0, 0);
+            if (limited)
+                old_planes.assign(state, state + (size_t)state_bits * la_chunks);
+            int included, excluded;
+            delta_kernel(state, la_chunks, &delta[(size_t)j * delta_bits * la_chunks], delta_bits, included, excluded);
+            if (limited && included > 0) {
+                int allowed = max(literal_budget - include_count[j], 0);
+                const unsigned int* old_top = &old_planes[(size_t)(state_bits - 1) * la_chunks];
                 for (int k = 0; k < la_chunks; k++) {
-                    // BOOST_TRUE_POSITIVE_FEEDBACK 옵션은 생략하고,
-                    // 입력이 1인 자리 중 피드백 스트림에 포함되지 않은 곳에 대해 inc,
-                    // 입력이 0인 자리 중 피드백 스트림에 포함된 곳에 대해 dec.
-                    unsigned int active_inc = Xi[k] & ~(feedback_to_la[k]);
-                    inc(j, k, active_inc);
-                    unsigned int active_dec = (~Xi[k]) & feedback_to_la[k];
-                    dec(j, k, active_dec);
+                    unsigned int gained = plane(j, state_bits - 1, k) & ~old_top[k];
+                    int count = __builtin_popcount(gained);
+                    if (count <= allowed) {
+                        allowed -= count;
+                        continue;
+                    }
+                    // 낮은 자리부터 allowed개만 남기고 나머지는 이전 상태로
+                    unsigned int revert = gained;
+                    for (int r = 0; r < allowed; r++) {
+                        revert &= revert - 1;
+                    }
+                    allowed = 0;
+                    for (int b = 0; b < state_bits; b++) {
+                        unsigned int old_word = old_planes[(size_t)b * la_chunks + k];
+                        plane(j, b, k) = (plane(j, b, k) & ~revert) | (old_word & revert);
+                    }
+                    included -= __builtin_popcount(revert);
                 }
             }
-            else {
+            if (absorbing) {
                 for (int k = 0; k < la_chunks; k++) {
-                    dec(j, k, feedback_to_la[k]);
+                    absorb(j, k, ~0u, ~0u);
                 }
             }
+            if (included != excluded)
+                __atomic_fetch_add(&include_count[j], included - excluded, __ATOMIC_RELAXED);
+            if (included + excluded > 0) {
+                __atomic_fetch_add(&decision_flips, (long long)(included + excluded), __ATOMIC_RELAXED);
+                mark_dirty(j);
+            }
         }
     }
 }
 
-// score 함수: 예측 모드로 절 출력 계산한 후, 투표 합을 반환합니다.
-int TsetlinMachine::score(const vector<unsigned int>& Xi) {
-    calculate_clause_output(Xi, true);
-    return sum_up_class_votes();
+// score 함수: 예측 모드로 켜지는 절의 투표를 합산하여 클립한 점수를 반환합니다.
+//  – 기본 scratch를 사용하지 않고, 샤딩 시에도 샤드별 부분합을 지역 배열에 모으므로 const (재진입 가능)
+int TsetlinMachine::score(const unsigned int* Xi) const {
+    if (pool == nullptr || shards <= 1)
+        return clip_votes(sum_fired_votes(Xi, 0, clauses));
+    vector<int> partial(shards, 0);
+    pool->run(shards, [&](int shard) {
+        int begin, end;
+        shard_range(shard, begin, end);
+        partial[shard] = sum_fired_votes(Xi, begin, end);
+    });
+    int class_sum = 0;
+    for (int sum : partial) {
+        class_sum += sum;
+    }
+    return clip_votes(class_sum);
+}
+
+// scratch 버전 score: 기본 scratch를 건드리지 않으므로 여러 스레드가 동시에 호출할 수 있음
+// (scratch가 다른 크기의 machine에서 만들어졌으면 필요한 만큼 늘림)
+int TsetlinMachine::score(const unsigned int* Xi, Scratch& scratch) const {
+    if ((int)scratch.clause_output.size() < clause_chunks)
+        scratch.clause_output.resize(clause_chunks);
+    calculate_clause_output(Xi, true, scratch.clause_output, 0, clauses);
+    return sum_up_class_votes(scratch.clause_output);
+}
+
+// 배치 score: 예제 i는 X + i * stride에서 시작. 행을 순서대로 읽으므로 연속 버퍼(Dataset)에서 prefetch가 잘 동작
+void TsetlinMachine::scoreBatch(const unsigned int* X, size_t stride, int count, int* scores,
+                                Scratch& scratch) const {
+    if ((int)scratch.clause_output.size() < clause_chunks)
+        scratch.clause_output.resize(clause_chunks);
+    for (int i = 0; i < count; i++) {
+        calculate_clause_output(X + i * stride, true, scratch.clause_output, 0, clauses);
+        scores[i] = sum_up_class_votes(scratch.clause_output);
+    }
+}
+
+// 배치 update: 예제 i에 targets[i]로 순서대로 update (온라인 학습과 같은 결과)
+void TsetlinMachine::updateBatch(const unsigned int* X, size_t stride, const int* targets, int count,
+                                 Scratch& scratch) {
+    for (int i = 0; i < count; i++) {
+        update(X + i * stride, targets[i], scratch);
+    }
+}
+
+// 상태 복사: 원본과 같은 풀을 동시에 쓰지 않도록 샤딩은 해제
+TsetlinMachine* TsetlinMachine::clone() const {
+    TsetlinMachine* copy = new TsetlinMachine(*this);
+    copy->pool = nullptr;
+    copy->shards = 1;
+    copy->shard_scratch.clear();
+    copy->pending_shard_rng.clear();
+    copy->local = createScratch();
+    return copy;
+}
+
+// 모델 저장 형식: [clauses][threshold][s][state_bits][리터럴 수] 뒤에 ta_state[절][비트][청크] 순서의 워드
+void TsetlinMachine::save(ostream& out) const {
+    int literals = num_literals;
+    out.write(reinterpret_cast<const char*>(&clauses), sizeof(clauses));
+    out.write(reinterpret_cast<const char*>(&threshold), sizeof(threshold));
+    out.write(reinterpret_cast<const char*>(&s), sizeof(s));
+    out.write(reinterpret_cast<const char*>(&state_bits), sizeof(state_bits));
+    out.write(reinterpret_cast<const char*>(&literals), sizeof(literals));
+    out.write(reinterpret_cast<const char*>(ta_state.data()), ta_state.size() * sizeof(unsigned int));
+}
+
+TsetlinMachine* TsetlinMachine::load(istream& in) {
+    int clauses, threshold, state_bits, literals;
+    double s;
+    in.read(reinterpret_cast<char*>(&clauses), sizeof(clauses));
+    in.read(reinterpret_cast<char*>(&threshold), sizeof(threshold));
+    in.read(reinterpret_cast<char*>(&s), sizeof(s));
+    in.read(reinterpret_cast<char*>(&state_bits), sizeof(state_bits));
+    in.read(reinterpret_cast<char*>(&literals), sizeof(literals));
+    // 외부 파일일 수 있으므로 tm_model_create와 같은 범위만 허용 (threshold가 0이면 feedbackThreshold에서 0으로 나눔)
+    if (!in || clauses <= 0 || threshold <= 0 || !isfinite(s) || s < 1.0 ||
+        state_bits < MIN_STATE_BITS || state_bits > MAX_STATE_BITS || literals <= 0 || literals % 2 != 0)
+        return nullptr;
+
+    TsetlinMachine* machine = new TsetlinMachine(clauses, threshold, s, state_bits, literals / 2);
+    in.read(reinterpret_cast<char*>(machine->ta_state.data()), machine->ta_state.size() * sizeof(unsigned int));
+    if (!in) {
+        delete machine;
+        return nullptr;
+    }
+    machine->recount_includes();
+    return machine;
+}
+
+// 절 분할 학습용: 이 machine이 맡은 절들의 투표 합 (클립하지 않음)
+int TsetlinMachine::partialVotes(const unsigned int* Xi, bool predict) {
+    calculate_clause_output(Xi, predict, local.clause_output, 0, clauses);
+    return sum_up_class_votes(local.clause_output, false);
+}
+
+// 절 분할 학습용: 직전 partialVotes(Xi, false)의 절 출력에 기준값 cutoff로 피드백 적용
+void TsetlinMachine::applyFeedback(const unsigned int* Xi, int target, uint64_t cutoff) {
+    apply_feedback(Xi, target, cutoff, local.clause_output, local.feedback_to_clauses, local, 0, clauses);
+}
+
+// 난수 상태 재설정: 기본 scratch와 샤드 scratch에 서로 다른 상태를 부여 (0이 되지 않도록 상수를 더함)
+void TsetlinMachine::seed(uint64_t value) {
+    local.rng = value * 0x9E3779B97F4A7C15ULL + 1;
+    pending_shard_rng.clear();
+    for (size_t i = 0; i < shard_scratch.size(); i++) {
+        shard_scratch[i].rng = (value + i + 1) * 0x9E3779B97F4A7C15ULL + 1;
+    }
+}
+
+vector<uint64_t> TsetlinMachine::randomState() const {
+    vector<uint64_t> state(1, local.rng);
+    for (const Scratch& scratch : shard_scratch) {
+        state.push_back(scratch.rng);
+    }
+    // 샤드를 아직 만들지 않았으면 복원 대기 중인 상태를 그대로 기록 (다시 저장해도 잃지 않도록)
+    if (shard_scratch.empty())
+        state.insert(state.end(), pending_shard_rng.begin(), pending_shard_rng.end());
+    return state;
+}
+
+void TsetlinMachine::setRandomState(const vector<uint64_t>& state) {
+    if (!state.empty())
+        local.rng = state[0];
+    pending_shard_rng.clear();
+    if (state.size() <= 1)
+        return;
+    if (shard_scratch.empty()) {
+        pending_shard_rng.assign(state.begin() + 1, state.end());
+        return;
+    }
+    for (size_t i = 0; i < shard_scratch.size() && i + 1 < state.size(); i++) {
+        shard_scratch[i].rng = state[i + 1];
+    }
+}
+
+void TsetlinMachine::getChunk(int clause, int chunk, unsigned int* planes) const {
+    for (int b = 0; b < state_bits; b++) {
+        planes[b] = load_word(plane(clause, b, chunk));
+    }
+}
+
+// 결정 비트 평면이 바뀌면 Include 수를 차이만큼 보정하고 절을 dirty로 표시
+void TsetlinMachine::setChunk(int clause, int chunk, const unsigned int* planes) {
+    unsigned int filter = (chunk == la_chunks - 1) ? last_chunk_filter : ~0u;
+    unsigned int old_include = load_word(plane(clause, state_bits - 1, chunk)) & filter;
+    unsigned int new_include = planes[state_bits - 1] & filter;
+    for (int b = 0; b < state_bits; b++) {
+        store_word(plane(clause, b, chunk), planes[b]);
+    }
+    if (old_include != new_include) {
+        include_count[clause] += __builtin_popcount(new_include) - __builtin_popcount(old_include);
+        mark_dirty(clause);
+    }
+}
+
+// 절 샤딩 설정: 절들을 INT_SIZE 배수 경계의 연속된 구간 shards개로 나누어 pool에서 처리
+void TsetlinMachine::setClauseShards(int num_shards, ThreadPool* thread_pool) {
+    pool = thread_pool;
+    shards = min(max(num_shards, 1), clause_chunks);
+    shard_scratch.clear();
+    for (int i = 0; i < shards; i++) {
+        shard_scratch.push_back(createScratch());
+        // 체크포인트에서 복원한 샤드 난수 상태가 있으면 이어서 사용
+        if (i < (int)pending_shard_rng.size())
+            shard_scratch[i].rng = pending_shard_rng[i];
+    }
+    pending_shard_rng.clear();
+}
+
+// 내부: shard번 샤드가 맡는 절 범위 [begin, end)
+void TsetlinMachine::shard_range(int shard, int& begin, int& end) const {
+    begin = (int)((long long)clause_chunks * shard / shards) * INT_SIZE;
+    end = min((int)((long long)clause_chunks * (shard + 1) / shards) * INT_SIZE, clauses);
+}
+
+// 모든 automaton의 상태값을 복원: 청크마다 비트 평면을 읽어 리터럴별 상태값으로 조립
+void TsetlinMachine::exportStates(int* out) const {
+    for (int j = 0; j < clauses; j++) {
+        int* row = out + (long long)j * num_literals;
+        for (int la = 0; la < num_literals; la++) {
+            row[la] = 0;
+        }
+        for (int k = 0; k < la_chunks; k++) {
+            for (int b = 0; b < state_bits; b++) {
+                unsigned int plane = load_word(this->plane(j, b, k));
+                while (plane) {
+                    int la = k * INT_SIZE + __builtin_ctz(plane);
+                    plane &= plane - 1;
+                    if (la < num_literals)
+                        row[la] |= (1 << b);
+                }
+            }
+        }
+    }
+}
+
+// 상태값을 비트 평면으로 기록한 뒤, 흡수 상태가 켜져 있으면 live 비트맵을 다시 계산
+void TsetlinMachine::importStates(const int* in) {
+    const int max_state = (1 << state_bits) - 1;
+    for (int j = 0; j < clauses; j++) {
+        const int* row = in + (long long)j * num_literals;
+        for (int k = 0; k < la_chunks; k++) {
+            unsigned int planes[MAX_STATE_BITS] = {0};
+            for (int pos = 0; pos < INT_SIZE && k * INT_SIZE + pos < num_literals; pos++) {
+                int state = min(max(row[k * INT_SIZE + pos], 0), max_state);
+                for (int b = 0; b < state_bits; b++) {
+                    if (state & (1 << b))
+                        planes[b] |= (1u << pos);
+                }
+            }
+            for (int b = 0; b < state_bits; b++) {
+                store_word(plane(j, b, k), planes[b]);
+            }
+        }
+    }
+    for (int j = 0; j < clauses; j++) {
+        mark_dirty(j);
+    }
+    recount_includes();
+    if (absorbing)
+        setAbsorbingState(absorb_lower, absorb_upper);
 }
 
 
 // 디버깅용: 특정 절과 리터럴의 상태값을 반환
-// 각 automaton의 상태는 STATE_BITS개의 비트를 모아 표현됨
+// 각 automaton의 상태는 state_bits개의 비트를 모아 표현됨
 int TsetlinMachine::getState(int clause, int la) {
     int chunk = la / INT_SIZE;
     int pos = la % INT_SIZE;
     int state = 0;
-    for (int b = 0; b < STATE_BITS; b++) {
-        if (ta_state[clause][chunk][b] & (1u << pos))
+    for (int b = 0; b < state_bits; b++) {
+        if (plane(clause, b, chunk) & (1u << pos))
             state |= (1 << b);
     }
     return state;
@@ -265,5 +1084,5 @@ int TsetlinMachine::getState(int clause, int la) {
 int TsetlinMachine::action(int clause, int la) {
     int chunk = la / INT_SIZE;
     int pos = la % INT_SIZE;
-    return (ta_state[clause][chunk][STATE_BITS - 1] & (1u << pos)) ? 1 : 0;
+    return (plane(clause, state_bits - 1, chunk) & (1u << pos)) ? 1 : 0;
 }
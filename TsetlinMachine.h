@@ -7,62 +7,313 @@
 
 
 #include <vector>
+#include <cstdint>
+#include <iostream>
+#include <algorithm>
 using namespace std;
 
+class ThreadPool;
+
 class TsetlinMachine {
 public:
-    // 생성자: clauses = 절의 수, threshold = 투표 임계값, s = 업데이트 확률 조절 파라미터
-    TsetlinMachine(int clauses, int threshold, double s);
+    // update 한 번에 필요한 임시 버퍼와 난수 상태.
+    // Hogwild 학습에서는 스레드마다 하나씩 소유하고 machine은 공유합니다.
+    struct Scratch {
+        vector<unsigned int> clause_output;       // 각 절의 출력 (비트 단위)
+        vector<unsigned int> feedback_to_la;      // Type I 피드백 스트림 (literal 단위)
+        vector<unsigned int> feedback_to_clauses; // 절별 피드백 적용 여부 (비트 단위)
+        uint64_t rng;                             // xorshift64* 상태
+        // true: 다른 스레드가 같은 machine을 동시에 갱신 중 (Hogwild). 상태 워드를 원자 단위로만 읽고 씀
+        bool hogwild = false;
+
+        // 32비트 난수 반환
+        unsigned int next_random() { return nextRandom(rng); }
+    };
+
+    // xorshift64* 한 단계: state를 갱신하고 32비트 난수 반환 (상태를 저장/복원할 수 있는 난수원)
+    static unsigned int nextRandom(uint64_t& state) {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return (unsigned int)((state * 2685821657736338717ULL) >> 32);
+    }
+
+    // 생성자: clauses = 절의 수, threshold = 투표 임계값, s = 업데이트 확률 조절 파라미터,
+    // state_bits = automaton 하나의 비트 평면 수 (MIN_STATE_BITS~MAX_STATE_BITS로 제한),
+    // features = 입력 특성 수 (리터럴은 각 특성과 그 부정으로 2 * features개)
+    TsetlinMachine(int clauses, int threshold, double s, int state_bits = 8, int features = 784);
+
+    static const int MIN_STATE_BITS = 2;
+    static const int MAX_STATE_BITS = 16;
+
+    // 온라인 학습: 입력 Xi (비트 청크 배열)와 target (0 또는 1)를 이용해 업데이트.
+    // 포인터 버전은 literalWords()개의 워드를 읽음 (Dataset의 행 등 다른 버퍼를 복사 없이 사용)
+    void update(const unsigned int* Xi, int target);
+    void update(const vector<unsigned int>& Xi, int target) { update(Xi.data(), target); }
+    // 호출자가 제공한 scratch를 사용하는 update. 스레드마다 hogwild를 켠 다른 scratch를 넘기면
+    // 같은 machine에 대해 동시에 호출할 수 있음 (Hogwild: 드문 충돌은 허용)
+    void update(const unsigned int* Xi, int target, Scratch& scratch);
+    void update(const vector<unsigned int>& Xi, int target, Scratch& scratch) { update(Xi.data(), target, scratch); }
+    // 배치 update: 예제 i는 X + i * stride (워드 단위)에서 시작, target은 targets[i]
+    void updateBatch(const unsigned int* X, size_t stride, const int* targets, int count, Scratch& scratch);
+
+    // 미니배치 학습: accumulate는 update와 같은 피드백을 ta_state 대신 automaton별 부호 있는 증감 버퍼에 누적하고,
+    // applyAccumulated가 누적된 증감을 절마다 한 번의 포화 비트 평면 덧셈으로 반영한 뒤 버퍼를 비움.
+    // 배치 동안의 절 출력은 마지막 apply 시점의 상태로 계산되므로 온라인 update와 근사적으로 같음.
+    // 증감은 ±2^(MAX_DELTA_BITS-1) 근처에서 포화하고, 리터럴 예산을 넘는 새 Include는 apply에서 이전 상태로 되돌림.
+    // 기본 scratch를 사용하므로 단일 스레드 전용
+    void accumulate(const unsigned int* Xi, int target);
+    void applyAccumulated();
+    static const int MAX_DELTA_BITS = 6;
+
+    // 이 machine의 크기에 맞는 scratch 생성 (난수 seed는 rand()에서 가져옴)
+    Scratch createScratch() const;
+
+    // 예측 점수 계산: 입력 Xi에 대해 절들의 투표를 합산하여 점수를 반환.
+    // 절 출력 비트맵을 만들지 않고 바로 투표를 세므로 여러 스레드가 같은 machine으로 동시에 호출 가능
+    int score(const unsigned int* Xi) const;
+    int score(const vector<unsigned int>& Xi) const { return score(Xi.data()); }
+    // 호출자가 제공한 scratch를 사용하는 score (스레드마다 다른 scratch를 넘기면 동시에 호출 가능)
+    int score(const unsigned int* Xi, Scratch& scratch) const;
+    int score(const vector<unsigned int>& Xi, Scratch& scratch) const { return score(Xi.data(), scratch); }
+    // 배치 score: 예제 i는 X + i * stride에서 시작하며 점수를 scores[i]에 기록
+    void scoreBatch(const unsigned int* X, size_t stride, int count, int* scores, Scratch& scratch) const;
+
+    // 증분 평가용 dirty 추적: 결정 비트(최상위 평면)가 바뀐 절을 비트맵으로 기록.
+    // takeDirtyClauses는 비트맵을 out에 복사하고 비움
+    void takeDirtyClauses(vector<unsigned int>& out);
+    void clearDirtyClauses();
+    // dirty가 켜진 절만 다시 계산하여 입력 Xi의 예측 모드 절 출력 비트맵(clause_output)을 갱신
+    void refreshClauseOutputs(const unsigned int* Xi, const vector<unsigned int>& dirty,
+                              vector<unsigned int>& clause_output) const;
+    // 절 출력 비트맵의 투표 합 (score와 같이 클립)
+    int votes(const vector<unsigned int>& clause_output) const;
+
+    // 상태를 복사한 새 machine (절 샤딩 설정은 복사하지 않음: 복사본은 단일 스레드로 동작)
+    TsetlinMachine* clone() const;
+
+    // 모델 저장: 절 수, threshold, s와 모든 비트 평면을 이진 형식으로 기록
+    void save(ostream& out) const;
+    // save로 기록한 machine을 읽어 새로 생성 (형식이나 값(threshold <= 0, s < 1 등)이 잘못되었거나 읽기에 실패하면 nullptr)
+    static TsetlinMachine* load(istream& in);
+
+    // 절 분할 학습용: 이 machine이 맡은 절들의 투표 합 (클립하지 않음).
+    // predict == false이면 절 출력을 기본 scratch에 남겨 applyFeedback에서 사용
+    int partialVotes(const unsigned int* Xi, bool predict);
+    int partialVotes(const vector<unsigned int>& Xi, bool predict) { return partialVotes(Xi.data(), predict); }
+    // 직전 partialVotes(Xi, false)의 절 출력에 대해, 전체 투표로 계산한 피드백 기준값(feedbackThreshold)으로 피드백 적용
+    void applyFeedback(const unsigned int* Xi, int target, uint64_t cutoff);
+    void applyFeedback(const vector<unsigned int>& Xi, int target, uint64_t cutoff) {
+        applyFeedback(Xi.data(), target, cutoff);
+    }
+    // 클립된 투표 합과 target으로 피드백 확률 p = (threshold + (1-2*target)*class_sum) / (2*threshold)를
+    // 고정소수점 기준값 floor(p * 2^32) ∈ [0, 2^32]로 계산. 32비트 난수 r이 r < 기준값이면 피드백 적용
+    // (부동소수점 변환 없이 정수 비교만 하므로 컴파일러와 관계없이 같은 결과)
+    static uint64_t feedbackThreshold(int class_sum, int target, int threshold);
 
-    // 온라인 학습: 입력 Xi (비트 청크 배열)와 target (0 또는 1)를 이용해 업데이트
-    void update(const vector<unsigned int>& Xi, int target);
+    // 난수 상태를 value로 다시 seed (여러 프로세스가 같은 시각에 생성될 때 스트림 분리용)
+    void seed(uint64_t value);
+    // 체크포인트용 난수 상태: 기본 scratch, 이어서 샤드 scratch들의 xorshift 상태.
+    // setRandomState가 받은 샤드 상태는 아직 샤드가 없으면 보관했다가 setClauseShards에서 적용
+    vector<uint64_t> randomState() const;
+    void setRandomState(const vector<uint64_t>& state);
 
-    // 예측 점수 계산: 입력 Xi에 대해 절들의 투표를 합산하여 점수를 반환
-    int score(const vector<unsigned int>& Xi);
+    // 체크포인트용 청크 접근: clause번 절 chunk번 청크의 비트 평면 stateBits()개를 planes로 복사 / planes로 덮어씀.
+    // setChunk는 Include 수와 dirty 비트를 함께 갱신
+    void getChunk(int clause, int chunk, unsigned int* planes) const;
+    void setChunk(int clause, int chunk, const unsigned int* planes);
 
     // 디버깅용: clause번 절의 la번 automaton의 상태값을 반환
     int getState(int clause, int la);
     // 디버깅용: clause번 절의 la번 automaton이 현재 행동(Include:1 / Exclude:0)인지 반환
     int action(int clause, int la);
 
+    int numClauses() const { return clauses; }
+    int stateBits() const { return state_bits; }
+    // 입력 예제 하나의 워드 수 (리터럴과 부정 리터럴을 INT_SIZE 비트씩 패킹)
+    int literalWords() const { return la_chunks; }
+    int numFeatures() const { return features; }
+    int numLiterals() const { return num_literals; }
+    int voteThreshold() const { return threshold; }
+    double specificity() const { return s; }
+    // clause번 절에서 Include된 리터럴 번호들을 out에 기록 (결정 비트 평면에서 추출)
+    void includedLiterals(int clause, vector<int>& out) const;
+    // 전체 automaton 수 (절 수 * 리터럴 수)
+    int numAutomata() const { return clauses * num_literals; }
+    // 모든 automaton의 상태값을 비트 평면에서 복원하여 out[clause * 리터럴 수 + la]에 기록
+    void exportStates(int* out) const;
+    // exportStates 형식의 상태값을 비트 평면으로 다시 기록 (범위를 벗어난 값은 포화)
+    void importStates(const int* in);
+
+    // 절 샤딩 설정: num_shards > 1이면 단일 스레드 update/score가 절들을 연속 구간으로 나누어
+    // pool에서 병렬 처리 (절 평가 → 투표 합산 → 피드백). pool은 호출자가 소유
+    void setClauseShards(int num_shards, ThreadPool* thread_pool);
+
+    // 흡수 상태 설정: 상태가 lower 이하 또는 upper 이상에 도달한 automaton은 동결되어 더 이상 피드백을 받지 않음
+    // (lower < 0 이고 upper >= 2^state_bits 이면 흡수 상태를 사용하지 않음)
+    void setAbsorbingState(int lower, int upper);
+
+    // 리터럴 예산: 절 하나가 Include할 수 있는 리터럴 수의 상한 (0 이하이면 제한 없음).
+    // 예산에 도달한 절은 Type I 피드백의 inc가 Exclude → Include로 넘기지 않으므로 절 평가 비용의 최악값이 고정됨.
+    // 설정 시점에 이미 예산을 넘은 절은 Include가 줄어들 때까지 새 Include를 받지 않음
+    void setLiteralBudget(int max_literals);
+    int literalBudget() const { return literal_budget; }
+    // 생성 이후 결정 비트가 바뀐 automaton 수의 누적값 (모델 변화량: epoch 전후 차이로 수렴 판단)
+    long long decisionFlips() const { return __atomic_load_n(&decision_flips, __ATOMIC_RELAXED); }
+    // clause번 절의 현재 Include 수 (inc/dec에서 증분 갱신)
+    int includeCount(int clause) const { return __atomic_load_n(&include_count[clause], __ATOMIC_RELAXED); }
+
 private:
     int clauses;      // 총 절의 수
     int threshold;    // 투표 임계값 (클립용)
     double s;         // 업데이트 확률 조절 파라미터
 
     // 내부 상수
-    static const int FEATURES = 784;                   // MNIST 이미지 (28x28)
-    static const int NUM_LITERALS = 2 * FEATURES;        // 각 특성과 그 부정 리터럴
     static const int INT_SIZE = sizeof(unsigned int) * 8;
-    static const int STATE_BITS = 8;                   // 각 automaton이 가지는 상태 비트 수
+    int features;                                      // 입력 특성 수 (MNIST 이미지는 28x28 = 784)
+    int num_literals;                                  // 각 특성과 그 부정 리터럴 (2 * features)
+    int state_bits;                                    // 각 automaton이 가지는 상태 비트 수
 
-    // 자동자 상태: 3차원 벡터 [절][LA_Chunk][STATE_BITS]
-    vector<vector<vector<unsigned int>>> ta_state;
-    // 각 절의 출력 (비트 단위로 저장, 절 하나당 한 비트)
-    vector<unsigned int> clause_output;
-    // 피드백을 줄 때 사용할 임시 벡터 (literal 단위)
-    vector<unsigned int> feedback_to_la;
-    // 각 절에 피드백 적용 여부를 저장 (비트 단위)
-    vector<unsigned int> feedback_to_clauses;
+    // 자동자 상태: 연속된 배열 [절][비트 평면][LA_Chunk] (한 평면의 청크들이 이어져 있음)
+    vector<unsigned int> ta_state;
+    // clause번 절의 b번 비트 평면에서 chunk번 워드 (b = state_bits-1이 결정 비트)
+    unsigned int& plane(int clause, int b, int chunk) {
+        return ta_state[((size_t)clause * state_bits + b) * la_chunks + chunk];
+    }
+    const unsigned int& plane(int clause, int b, int chunk) const {
+        return ta_state[((size_t)clause * state_bits + b) * la_chunks + chunk];
+    }
+    // 단일 스레드 update/score가 사용하는 기본 scratch
+    Scratch local;
 
     // 내부: 초기화 함수 (ta_state 등 초기화)
     void initialize();
     // 내부: 각 절의 출력(클래스 vote용)을 계산 (predict 모드와 update 모드 구분) 하나의 clause
-    void calculate_clause_output(const vector<unsigned int>& Xi, bool predict);
+    void calculate_clause_output(const unsigned int* Xi, bool predict,
+                                 vector<unsigned int>& clause_output, int begin, int end) const;
     // 내부: 모든 절의 투표 합산 (짝수 절은 +, 홀수 절은 -)
-    int sum_up_class_votes();
+    int sum_up_class_votes(const vector<unsigned int>& clause_output, bool clip = true) const;
+    // 내부: [begin, end) 범위 절 중 예측 모드에서 켜지는 절의 투표 합 (비트맵 없이 바로 합산, 클립하지 않음)
+    int sum_fired_votes(const unsigned int* Xi, int begin, int end) const;
+    // 내부: 투표 합을 [-threshold, threshold]로 클립
+    int clip_votes(int class_sum) const { return min(max(class_sum, -threshold), threshold); }
+
+    // 내부: 절 j 하나의 출력
+    bool clause_fires(const unsigned int* Xi, int j, bool predict) const;
+    // 내부: 절의 결정 비트가 바뀌었음을 dirty 비트맵에 기록
+    void mark_dirty(int clause);
+    // 내부: [begin, end) 범위 절에 피드백 대상을 정하고 Type I / Type II 피드백 적용
+    void apply_feedback(const unsigned int* Xi, int target, uint64_t cutoff,
+                        const vector<unsigned int>& clause_output,
+                        vector<unsigned int>& feedback_to_clauses,
+                        Scratch& scratch, int begin, int end);
+    // 내부: shard번 샤드가 맡는 절 범위 [begin, end)
+    void shard_range(int shard, int& begin, int& end) const;
+
+    // 비트 평면 수별로 인스턴스화된 캐리 체인 (BITS가 상수이므로 완전히 펼쳐짐).
+    // planes[b * stride]가 b번 평면이며, 결정 비트가 바뀐 automata를 반환
+    template <int BITS> static unsigned int inc_planes(unsigned int* planes, int stride, unsigned int active);
+    template <int BITS> static unsigned int dec_planes(unsigned int* planes, int stride, unsigned int active);
+    typedef unsigned int (*CarryKernel)(unsigned int* planes, int stride, unsigned int active);
+    // state_bits에 맞는 인스턴스 (생성 시 선택)
+    CarryKernel inc_kernel;
+    CarryKernel dec_kernel;
+
+    // 절 하나의 모든 청크에 대한 fused 피드백 커널 (BitPlaneKernels.h의 feedback_planes<BITS, KIND, unsigned int>).
+    // 종류(FeedbackKind)별로 Exclude → Include로 바뀐 수를 included, Include → Exclude로 바뀐 수를 excluded에 기록
+    typedef void (*FeedbackKernel)(unsigned int* planes, int chunks, const unsigned int* Xi,
+                                   const unsigned int* stream, unsigned int last_filter, int& included, int& excluded);
+    FeedbackKernel feedback_kernels[3];
+    // 흡수 상태 사용 시: last_filter 대신 절의 live 비트맵으로 거르고, 같은 순회에서 경계에 닿은 automata를
+    // live(와 live_chunks)에서 제거. 모두 동결된 청크 묶음은 평면을 읽지 않고 건너뜀
+    template <int BITS, int KIND>
+    static void absorbing_feedback_planes(unsigned int* planes, int chunks, const unsigned int* Xi,
+                                          const unsigned int* stream, unsigned int* live, unsigned int* live_chunks,
+                                          int lower, int upper, int& included, int& excluded);
+    typedef void (*AbsorbingKernel)(unsigned int* planes, int chunks, const unsigned int* Xi,
+                                    const unsigned int* stream, unsigned int* live, unsigned int* live_chunks,
+                                    int lower, int upper, int& included, int& excluded);
+    AbsorbingKernel absorbing_kernels[3];
+    void select_kernels();
 
     // 내부: 선택된 automata에 대해 상태를 증가(inc) (비트 단위 캐리 연산)
     void inc(int clause, int chunk, unsigned int active);
     // 내부: 선택된 automata에 대해 상태를 감소(dec)
     void dec(int clause, int chunk, unsigned int active);
+    // 내부: 상태값이 value 이상인 automata를 비트마스크로 반환 (비트 단위 비교)
+    unsigned int state_at_least(int clause, int chunk, int value);
+    // 내부: 결정 비트 평면에서 절별 Include 수를 다시 계산
+    void recount_includes();
+    // 내부: 절 하나의 증감 버퍼(delta = 0번 증감 평면의 0번 청크, 평면 간격 chunks)에 KIND 피드백을 누적.
+    // inc할 automata는 +1, dec할 automata는 -1 (D비트 2의 보수에서 포화). live 밖의 automata는 제외.
+    // feedback_planes와 같이 여러 청크를 SIMD 벡터로 묶어 처리
+    template <int D, int KIND>
+    static void accumulate_planes(unsigned int* delta, int chunks, const unsigned int* Xi, const unsigned int* stream,
+                                  const unsigned int* top, const unsigned int* live);
+    typedef void (*AccumulateKernel)(unsigned int* delta, int chunks, const unsigned int* Xi,
+                                     const unsigned int* stream, const unsigned int* top, const unsigned int* live);
+    AccumulateKernel accumulate_kernels[3];
+    // 비트 평면 수별 포화 덧셈: 절 하나의 상태(planes = 0번 평면의 0번 청크, 평면 간격 chunks)에
+    // 증감 버퍼(delta, 같은 간격)의 delta_bits비트 2의 보수를 더해 0 ~ 2^BITS-1로 포화하고 증감 버퍼를 비움.
+    // 여러 청크를 SIMD 벡터로 묶어 처리하고, 증감이 없는 청크는 쓰지 않음
+    template <int BITS> static void add_delta_planes(unsigned int* planes, int chunks, unsigned int* delta,
+                                                     int delta_bits, int& included, int& excluded);
+    typedef void (*DeltaKernel)(unsigned int* planes, int chunks, unsigned int* delta, int delta_bits,
+                                int& included, int& excluded);
+    DeltaKernel delta_kernel;
+    // 내부: [begin, end) 범위 절마다 난수를 뽑아 기준값 cutoff 미만이면 피드백 대상으로 표시
+    void draw_feedback_clauses(uint64_t cutoff, vector<unsigned int>& feedback_to_clauses,
+                               Scratch& scratch, int begin, int end);
+    // 내부: raised(상태가 오른 automata) 중 upper 이상, lowered(내려간 automata) 중 lower 이하를 live 비트맵에서 제거
+    void absorb(int clause, int chunk, unsigned int raised, unsigned int lowered);
     // 내부: 피드백용 random stream을 초기화 (feedback_to_la를 무작위 활성화)
-    void initialize_random_streams();
+    void initialize_random_streams(Scratch& scratch);
+
+    // 경쟁 허용 접근: Hogwild 학습에서는 여러 스레드가 같은 상태 워드를 읽고 쓰므로
+    // relaxed 원자 load/store를 사용 (x86에서는 일반 mov와 동일, 잃어버린 갱신은 허용)
+    static unsigned int load_word(const unsigned int& w) { return __atomic_load_n(&w, __ATOMIC_RELAXED); }
+    static void store_word(unsigned int& w, unsigned int v) { __atomic_store_n(&w, v, __ATOMIC_RELAXED); }
+
+    // 마지막 평가 이후 결정 비트가 바뀐 절 (비트 단위)
+    vector<unsigned int> dirty_clauses;
+
+    // 절 샤딩: 작업자 풀(외부 소유), 샤드 수, 샤드별 scratch (Type I 스트림과 난수)
+    ThreadPool* pool;
+    int shards;
+    vector<Scratch> shard_scratch;
+    // setRandomState로 받았지만 아직 적용할 샤드 scratch가 없는 샤드 난수 상태 (randomState에도 그대로 포함)
+    vector<uint64_t> pending_shard_rng;
+
+    // 절별 Include 수와 리터럴 예산 (예산이 리터럴 수와 같으면 제한 없음)
+    vector<int> include_count;
+    int literal_budget;
+    // 결정 비트 변경 누적 수 (inc/dec에서 원자적으로 증가)
+    long long decision_flips;
+
+    // 미니배치 증감 버퍼 [절][증감 비트][LA_Chunk] (2의 보수 비트 평면, 처음 accumulate할 때 할당)
+    vector<unsigned int> delta;
+    vector<unsigned int> delta_clauses; // 증감이 누적된 절 (비트 단위)
+    int delta_bits;                     // min(state_bits, MAX_DELTA_BITS)
+
+    // 흡수 상태 사용 여부와 경계값
+    bool absorbing;
+    int absorb_lower;
+    int absorb_upper;
+    // 아직 동결되지 않은 automata 비트맵 [절][LA_Chunk]
+    vector<vector<unsigned int>> live;
+    // 살아있는 automata가 하나라도 남은 청크를 나타내는 비트맵 [절][청크/INT_SIZE]
+    vector<vector<unsigned int>> live_chunks;
 
     // 편의를 위해 CLAUSE_CHUNKS (절들을 비트로 저장하기 위한 청크 수)를 계산
     int clause_chunks;
-    // LA_CHUNKS: 2*FEATURES를 INT_SIZE 단위로 나눈 청크 수
+    // LA_CHUNKS: 2*features를 INT_SIZE 단위로 나눈 청크 수
     int la_chunks;
+    // live_chunks 한 줄의 워드 수
+    int live_chunk_words;
+    // 마지막 LA 청크에서 유효한 비트 마스크
+    unsigned int last_chunk_filter;
+    // Type I 피드백 스트림에서 켜는 리터럴 수 (round(리터럴 수 / s), 생성 시 한 번 계산)
+    int stream_literals;
 };
 
 #endif //TSETLIN_MACHINE_TSETLINMACHINE_H
@@ -1,5 +1,12 @@
 // main.cpp
 #include "MultiClassTsetlin.h"  // MultipleClassTsetlin 클래스 정의 헤더
+#include "IncrementalEvaluator.h"
+#include "BatchInference.h"
+#include "BooleanEncoder.h"
+#include "Checkpoint.h"
+#include "ModelCompactor.h"
+#include "FixedTsetlinMachine.h"
+#include "ThreadPool.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -8,6 +15,8 @@
 #include <chrono>
 #include <cstdlib>
 #include <ctime>
+#include <memory>
+#include <mutex>
 
 using namespace std;
 using namespace std::chrono;
@@ -15,34 +24,13 @@ using namespace std::chrono;
 
 const int NUMBER_OF_TRAINING_EXAMPLES = 60000;
 const int NUMBER_OF_TEST_EXAMPLES = 10000;
+const int VALIDATION_EVERY = 10;    // 학습 예제 10개 중 1개를 검증용으로 떼어 냄
 const int FEATURES = 784;           // MNIST: 28x28 이미지
 const int INT_SIZE = 32;            // 32비트 unsigned int 사용
-// 각 예제는 원본 784개와 보수 784개, 즉 총 1568개 리터럴을 저장하므로:
-const int LA_CHUNKS = (2 * FEATURES + INT_SIZE - 1) / INT_SIZE;
-
-// 한 예제의 픽셀 데이터를 읽어, 2*FEATURES 길이의 비트벡터(vector<unsigned int>)로 패킹하는 함수
-vector<unsigned int> packExample(const vector<int> &sample) {
-    vector<unsigned int> result(LA_CHUNKS, 0);//0으로 초기화, 784 * 2 만큼
-    for (int j = 0; j < FEATURES; j++) {
-        if (sample[j] == 1) {
-            // 원본: 픽셀이 1이면 해당 비트를 켬
-            int chunk_nr = j / INT_SIZE; //몇 번째 블록
-            int chunk_pos = j % INT_SIZE; //몇 번째 자리
-            result[chunk_nr] |= (1u << chunk_pos);
-        } else {
-            // 보수: 픽셀이 0이면, 보수 부분에서 (j+FEATURES)번째 리터럴에 1을 설정
-            int index = j + FEATURES; //784만큼 뒤에 본인의 보수가 위치해 있음
-            int chunk_nr = index / INT_SIZE;
-            int chunk_pos = index % INT_SIZE;
-            result[chunk_nr] |= (1u << chunk_pos); //그 부분을 1로 변경
-        }
-    }
-    return result;
-}
-
 
-// 각 줄은 "b0 b1 ... b783 label" 형태
-void readData(const string &filename, vector<vector<unsigned int>> &X, vector<int> &y, int numExamples) {
+// 각 줄은 "b0 b1 ... b783 label" 형태 (픽셀은 0/1 또는 0~255 회색조).
+// encoder로 리터럴 + 부정 리터럴 비트를 패킹하여 연속 버퍼(Dataset)에 바로 기록
+void readData(const string &filename, const BooleanEncoder &encoder, Dataset &data, int numExamples) {
 
     ifstream inFile(filename);
     if (!inFile) {
@@ -55,27 +43,38 @@ void readData(const string &filename, vector<vector<unsigned int>> &X, vector<in
     int count = 0;
     while (getline(inFile, line) && count < numExamples) {
         istringstream iss(line);
-        vector<int> sample;
-        sample.reserve(FEATURES);
+        vector<uint8_t> sample(FEATURES, 0);
         // 픽셀 데이터 784개 읽기
         for (int i = 0; i < FEATURES; i++) {
             int pixel;
             if (!(iss >> pixel))
                 break;
-            sample.push_back(pixel);
+            sample[i] = (uint8_t)min(max(pixel, 0), 255);
         }
         // 다음 토큰은 라벨
         int label;
         if (!(iss >> label))
             break;
-        y.push_back(label);
-        X.push_back(packExample(sample));
+        encoder.encode(sample.data(), data.append(label));
         count++;
     }
     inFile.close();
 }
 
-void printDigit(const vector<unsigned int> &Xi) {
+// all의 예제 every개마다 하나를 validation으로, 나머지를 train으로 나눔 (순서 유지).
+// 조기 종료와 최고 스냅샷 선택은 validation으로만 판단하고, 테스트 데이터는 마지막에 한 번만 평가
+void splitValidation(const Dataset &all, Dataset &train, Dataset &validation, int every) {
+    train.reserve(all.size() - all.size() / every);
+    validation.reserve(all.size() / every);
+    for (size_t i = 0; i < all.size(); i++) {
+        if (i % every == (size_t)every - 1)
+            validation.add(all.row(i), all.label(i));
+        else
+            train.add(all.row(i), all.label(i));
+    }
+}
+
+void printDigit(const unsigned int *Xi) {
     for (int row = 0; row < 28; row++) {
         for (int col = 0; col < 28; col++) {
             int index = row * 28 + col;
@@ -87,83 +86,282 @@ void printDigit(const vector<unsigned int> &Xi) {
     }
 }
 
+// 공용 풀에서 함께 도는 평가와 학습 작업의 출력이 섞이지 않도록 보호
+mutex outputMutex;
+
+// epoch 끝에 뜬 스냅샷으로 검증 데이터(0번)와 샘플 학습 데이터(1번)를 평가하고, 끝나는 대로 결과를 출력.
+// 증분 평가: 이전 스냅샷 이후 결정 비트가 바뀐 절만 다시 계산. 검증 정확도(%)를 반환
+double evaluateSnapshot(MultipleClassTsetlin &snapshot, int epoch, IncrementalEvaluator &evaluator) {
+    auto startEval = steady_clock::now();
+    evaluator.refresh(snapshot);
+    // 검증 데이터 평가
+    double validationAccuracy = 100.0 * evaluator.accuracy(0);
+    // 샘플 학습 데이터 평가 (빠른 확인용)
+    double trainSampleAccuracy = 100.0 * evaluator.accuracy(1);
+    auto endEval = steady_clock::now();
+    double evalTime = duration<double>(endEval - startEval).count();
+
+    lock_guard<mutex> lock(outputMutex);
+    cout << "Epoch " << (epoch + 1) << " Evaluation Time: " << evalTime << " s ("
+         << 100.0 * evaluator.lastDirtyFraction() << " % of clauses recomputed)\n";
+    cout << "Epoch " << (epoch + 1) << " Validation Accuracy: " << validationAccuracy << " %\n";
+    cout << "Epoch " << (epoch + 1) << " Training Sample Accuracy: " << trainSampleAccuracy << " %\n";
+    return validationAccuracy;
+}
+
+// 체크포인트에 함께 기록하는 학습 진행 상태: 조기 종료 기록을 시작한 epoch, 조기 종료 기록,
+// 평가 중인 스냅샷(= 체크포인트 모델)의 결정 비트 변화율. 재개하면 그 스냅샷의 평가부터 다시 진행
+string saveProgress(int stoppingStart, const EarlyStopping &stopping, double churn) {
+    ostringstream out;
+    out.write(reinterpret_cast<const char *>(&stoppingStart), sizeof(stoppingStart));
+    stopping.save(out);
+    out.write(reinterpret_cast<const char *>(&churn), sizeof(churn));
+    return out.str();
+}
+
+// saveProgress로 기록한 상태 복원 (형식이 맞지 않으면 아무것도 바꾸지 않고 false)
+bool loadProgress(const string &progress, int &stoppingStart, EarlyStopping &stopping, double &churn) {
+    istringstream in(progress);
+    int savedStart;
+    double savedChurn;
+    EarlyStopping restored = stopping;
+    in.read(reinterpret_cast<char *>(&savedStart), sizeof(savedStart));
+    if (!in || !restored.load(in) || !in.read(reinterpret_cast<char *>(&savedChurn), sizeof(savedChurn)))
+        return false;
+    stoppingStart = savedStart;
+    stopping = restored;
+    churn = savedChurn;
+    return true;
+}
+
 int main() {
     srand(static_cast<unsigned>(time(nullptr)));
 
-    vector<vector<unsigned int>> X_train; //픽셀
-    vector<int> y_train;  //라벨
-    vector<vector<unsigned int>> X_test;
-    vector<int> y_test;
-    vector<vector<unsigned int>> X_train_sampled;
-    vector<int> y_train_sampled;
+    // 이진화된 파일(0/1)은 임계값 1로 그대로 패킹.
+    // 회색조 원본이면 BooleanEncoder::threshold(FEATURES, 128) 또는 BooleanEncoder::thermometer(FEATURES, 4) 등
+    BooleanEncoder encoder = BooleanEncoder::threshold(FEATURES, 1);
+
+    // 픽셀(패킹된 리터럴)과 라벨
+    Dataset train(encoder.words());
+    Dataset validation(encoder.words());
+    Dataset test(encoder.words());
+    Dataset trainSampled(encoder.words());
+    test.reserve(NUMBER_OF_TEST_EXAMPLES);
+    trainSampled.reserve(NUMBER_OF_TEST_EXAMPLES);
+
+    // 평가, 배치 예측, Hogwild 학습이 함께 쓰는 공용 스레드 풀 (TM_THREADS=N, TM_AFFINITY=1로 설정)
+    ThreadPool& pool = ThreadPool::shared();
+    cout << "Thread pool: " << pool.size() << " threads" << (pool.pinned() ? " (pinned to cores)" : "") << "\n";
 
     cout << "Reading training data...\n";
-    readData("MNISTTraining.txt", X_train, y_train, NUMBER_OF_TRAINING_EXAMPLES);
+    {
+        Dataset all(encoder.words());
+        all.reserve(NUMBER_OF_TRAINING_EXAMPLES);
+        readData("MNISTTraining.txt", encoder, all, NUMBER_OF_TRAINING_EXAMPLES);
+        splitValidation(all, train, validation, VALIDATION_EVERY);
+    }
+    cout << train.size() << " training / " << validation.size() << " validation examples\n";
 
     cout << "Reading test data...\n";
-    readData("MNISTTest.txt", X_test, y_test, NUMBER_OF_TEST_EXAMPLES);
+    readData("MNISTTest.txt", encoder, test, NUMBER_OF_TEST_EXAMPLES);
 
     cout << "Reading sampled training data...\n";
-    readData("MNISTTrainingSampled.txt", X_train_sampled, y_train_sampled, NUMBER_OF_TEST_EXAMPLES);
+    readData("MNISTTrainingSampled.txt", encoder, trainSampled, NUMBER_OF_TEST_EXAMPLES);
 
     // 임의의 테스트 예제를 선택하여 출력 (데이터 확인용)
-    int example = rand() % X_test.size();
-    cout << "\nExample digit (label = " << y_test[example] << "):\n\n";
-    printDigit(X_test[example]);
+    int example = rand() % test.size();
+    cout << "\nExample digit (label = " << test.label(example) << "):\n\n";
+    printDigit(test.row(example));
 
     // MultipleClassTsetlin 객체를 직접 생성 (CreateMultiClassTsetlinMachine() 없이)
-    int numClasses = 10;  // MNIST의 클래스 수: 0~9
-    int clauses = 100;    // 각 클래스당 절의 수 (예시)
+    constexpr int numClasses = 10;  // MNIST의 클래스 수: 0~9
+    constexpr int clauses = 100;    // 각 클래스당 절의 수 (예시)
     int threshold = 15;   // 투표 임계값 (예시)
     double s = 3.9;       // 업데이트 확률 조절 파라미터 (예시)
-    MultipleClassTsetlin mc_tm(numClasses, clauses, threshold, s);
+    constexpr int stateBits = 8;    // automaton당 비트 평면 수 (2~16, 작을수록 메모리와 학습 시간 감소)
+    MultipleClassTsetlin mc_tm(numClasses, clauses, threshold, s, stateBits, encoder.outputFeatures());
+    int literalBudget = 0; // 절당 Include 리터럴 수 상한 (0이면 제한 없음)
+    mc_tm.setLiteralBudget(literalBudget);
+    int miniBatch = 1; // 1보다 크면 이만큼의 예제 피드백을 모아 한 번에 반영 (한 스레드로 학습할 때)
+    mc_tm.setMiniBatch(miniBatch);
+    int trainThreads = 1; // 1보다 크면 Hogwild 방식으로 여러 작업이 공용 풀에서 같은 모델을 동시에 학습
 
-    constexpr int EPOCHS = 100;
-    for (int epoch = 0; epoch < EPOCHS; epoch++) {
-        cout << "\nEpoch " << (epoch + 1) << "\n";
+    constexpr int EPOCHS = 100; // 최대 epoch 수 (조기 종료되면 더 일찍 끝남)
+    // 검증 정확도가 10 epoch 동안 개선되지 않거나, epoch 동안 결정 비트가 바뀐 automata가 0.001% 이하이면 중단
+    EarlyStopping stopping(10, 0.0, 1e-5);
+    int stoppingStart = 0;                       // stopping의 첫 기록이 가리키는 epoch
+    shared_ptr<MultipleClassTsetlin> best;       // 검증 정확도가 가장 높았던 스냅샷
+    shared_ptr<MultipleClassTsetlin> evaluating; // 진행 중인 평가의 스냅샷
+    double evaluatingChurn = 1.0;                // 그 스냅샷까지의 epoch 동안 결정 비트 변화율
 
-        auto startTrain = steady_clock::now();
-        // 모든 학습 예제에 대해 One-vs-All 방식 학습 (각 예제마다 한 번씩 업데이트)
-        for (size_t i = 0; i < X_train.size(); i++) {
-            mc_tm.train(X_train[i], y_train[i]);
+    // 체크포인트가 있으면 그 상태(비트 평면, 난수 상태, epoch, 조기 종료 기록과 최고 스냅샷)에서 이어서 학습
+    const string checkpointPath = "tsetlin_checkpoint.bin";
+    int startEpoch = 0;
+    string progress;
+    MultipleClassTsetlin* resumed = Checkpointer::resume(checkpointPath, startEpoch, &progress);
+    if (resumed != nullptr) {
+        if (resumed->numClasses() == mc_tm.numClasses() && resumed->numAutomata() == mc_tm.numAutomata() &&
+            resumed->machine(0).stateBits() == stateBits) {
+            mc_tm.copyStatesFrom(*resumed);
+            mc_tm.setRandomState(resumed->randomState());
+            cout << "\nResuming from checkpoint after epoch " << startEpoch << "\n";
+            if (loadProgress(progress, stoppingStart, stopping, evaluatingChurn)) {
+                // 체크포인트 모델은 기록 당시 평가 중이던 스냅샷이므로 아래에서 다시 평가
+                evaluating.reset(mc_tm.snapshot());
+                mc_tm.clearDirtyClauses();
+                int bestEpoch = -1;
+                MultipleClassTsetlin* saved = stopping.bestEpoch() >= 0 ?
+                                              Checkpointer::resumeBest(checkpointPath, bestEpoch) : nullptr;
+                if (saved != nullptr && bestEpoch == stoppingStart + stopping.bestEpoch() &&
+                    saved->numAutomata() == mc_tm.numAutomata()) {
+                    best.reset(saved);
+                } else {
+                    delete saved;
+                    if (stopping.bestEpoch() >= 0)
+                        cerr << "Best snapshot missing from checkpoint, the final model will not be restored to it"
+                             << endl;
+                }
+            } else {
+                // 이전 형식의 체크포인트: 조기 종료는 재개한 epoch부터 새로 판단
+                stoppingStart = startEpoch;
+            }
+        } else {
+            cerr << "Checkpoint does not match the model configuration, starting over" << endl;
+            startEpoch = 0;
         }
-        auto endTrain = steady_clock::now();
-        double trainTime = duration<double>(endTrain - startTrain).count();
-        cout << "Training Time: " << trainTime << " s\n";
+        delete resumed;
+    }
+    // 매 epoch 끝의 스냅샷을 백그라운드에서 기록 (처음은 전체, 이후는 바뀐 워드만)
+    Checkpointer checkpointer(checkpointPath);
 
-        // 테스트 데이터 평가
-        auto startEval = steady_clock::now();
-        int correct = 0;
-        for (size_t i = 0; i < X_test.size(); i++) {
-            int prediction = mc_tm.predict(X_test[i]);
-            if (prediction == y_test[i])
-                correct++;
+    long long flips = mc_tm.decisionFlips();
+    IncrementalEvaluator evaluator;
+    evaluator.addDataset(validation);
+    evaluator.addDataset(trainSampled);
+    // evaluating이 아직 평가하지 않은 스냅샷이면 true (재개했으면 체크포인트 모델부터 평가)
+    bool evaluationPending = (bool)evaluating;
+    int evaluatingEpoch = startEpoch - 1;
+    // 한 스레드 학습은 남은 epoch 전체에 로더 하나: 로더 스레드가 epoch 경계에서도 다음 배치를 미리 준비
+    unique_ptr<DataLoader> loader;
+    if (trainThreads <= 1)
+        loader = mc_tm.makeLoader(train, EPOCHS - startEpoch);
+    for (int epoch = startEpoch; epoch < EPOCHS; epoch++) {
+        {
+            lock_guard<mutex> lock(outputMutex);
+            cout << "\nEpoch " << (epoch + 1) << "\n";
         }
-        auto endEval = steady_clock::now();
-        double evalTime = duration<double>(endEval - startEval).count();
-        double testAccuracy = 100.0 * correct / X_test.size();
-        cout << "Evaluation Time: " << evalTime << " s\n";
-        cout << "Test Accuracy: " << testAccuracy << " %\n";
-
-        // 샘플 학습 데이터 평가 (빠른 확인용)
-        correct = 0;
-        for (size_t i = 0; i < X_train_sampled.size(); i++) {
-            int prediction = mc_tm.predict(X_train_sampled[i]);
-            if (prediction == y_train_sampled[i])
+
+        // 이번 epoch의 학습(0번 작업)과 이전 epoch 스냅샷의 평가(1번 작업)를 공용 풀에서 함께 실행.
+        // 평가는 한 번에 하나만 진행되고, 조기 종료 판단은 평가가 끝난 이전 epoch 결과로 함 (한 epoch 늦게 반영)
+        double accuracy = 0.0;
+        pool.run(evaluationPending ? 2 : 1, [&](int task) {
+            if (task == 1) {
+                accuracy = evaluateSnapshot(*evaluating, evaluatingEpoch, evaluator);
+                return;
+            }
+            auto startTrain = steady_clock::now();
+            // 모든 학습 예제에 대해 One-vs-All 방식 학습 (각 예제마다 한 번씩 업데이트)
+            if (loader) {
+                mc_tm.fitEpoch(*loader);
+            } else {
+                mc_tm.fitHogwild(train, 1, trainThreads);
+            }
+            double trainTime = duration<double>(steady_clock::now() - startTrain).count();
+            lock_guard<mutex> lock(outputMutex);
+            cout << "Epoch " << (epoch + 1) << " Training Time: " << trainTime << " s\n";
+        });
+
+        if (evaluationPending) {
+            evaluationPending = false;
+            if (stopping.record(accuracy, evaluatingChurn)) {
+                best = evaluating;
+                checkpointer.saveBest(best, stoppingStart + stopping.bestEpoch());
+            }
+            if (stopping.shouldStop()) {
+                cout << "Early stopping after epoch " << (epoch + 1)
+                     << (stopping.hasConverged() ? " (decision bits converged)" : " (no improvement)") << "\n";
+                break;
+            }
+        }
+        // 스냅샷이 dirty 비트를 복사해 갔으므로 원본은 비워서 다음 epoch의 변화만 기록
+        shared_ptr<MultipleClassTsetlin> snapshot(mc_tm.snapshot());
+        mc_tm.clearDirtyClauses();
+        long long now = mc_tm.decisionFlips();
+        evaluatingChurn = (double)(now - flips) / mc_tm.numAutomata();
+        flips = now;
+        evaluating = snapshot;
+        evaluatingEpoch = epoch;
+        evaluationPending = true;
+        checkpointer.save(snapshot, mc_tm.randomState(), epoch + 1,
+                          saveProgress(stoppingStart, stopping, evaluatingChurn));
+    }
+    // 마지막 epoch의 스냅샷은 학습이 끝난 뒤 평가
+    if (evaluationPending) {
+        double accuracy = evaluateSnapshot(*evaluating, evaluatingEpoch, evaluator);
+        if (stopping.record(accuracy, evaluatingChurn))
+            best = evaluating;
+    }
+
+    // 가장 좋았던 epoch의 상태로 복원
+    if (best) {
+        mc_tm.copyStatesFrom(*best);
+        cout << "\nRestored best snapshot from epoch " << (stoppingStart + stopping.bestEpoch() + 1)
+             << " (validation accuracy " << stopping.bestAccuracy() << " %)\n";
+    }
+
+    // 최종 모델을 전치 배치 추론으로 전체 테스트 데이터에 대해 평가 (학습 중에는 테스트 데이터를 쓰지 않음)
+    auto startFinal = steady_clock::now();
+    BatchInference engine(mc_tm);
+    double finalAccuracy = 100.0 * engine.evaluate(test);
+    double finalTime = duration<double>(steady_clock::now() - startFinal).count();
+    cout << "\nFinal Test Accuracy: " << finalAccuracy << " % (batch inference " << finalTime << " s)\n";
+
+    // 학습된 모델 저장 (tm_server 등에서 불러와 사용)
+    if (!mc_tm.save("tsetlin_model.bin"))
+        cerr << "Error saving model: tsetlin_model.bin" << endl;
+
+    // 추론용 압축 모델: 학습 데이터에서 예측이 같도록 죽은 절, 상쇄되는 절 쌍, 중복 절을 제거
+    ModelCompactor::Report report;
+    unique_ptr<MultipleClassTsetlin> compacted(ModelCompactor::compact(mc_tm, train, &report));
+    BatchInference compactEngine(*compacted);
+    cout << "Compacted model: " << report.clauses_before << " -> " << report.clauses_after << " clauses ("
+         << report.empty << " empty, " << report.never_fired << " never fired, "
+         << report.opposite_pairs << " cancelling pairs, " << report.duplicates << " duplicates), "
+         << "test accuracy " << 100.0 * compactEngine.evaluate(test) << " %\n";
+    if (!compacted->save("tsetlin_model_compact.bin"))
+        cerr << "Error saving model: tsetlin_model_compact.bin" << endl;
+
+    // 모양이 컴파일 타임 상수인 특수화 모델로 같은 예측 (encoder 출력 특성 수가 FEATURES와 다르면 건너뜀)
+    typedef FixedMultiClassTsetlin<numClasses, FEATURES, clauses, uint64_t, stateBits> FixedModel;
+    unique_ptr<FixedModel> fixed(FixedModel::fromModel(mc_tm));
+    if (fixed) {
+        auto startFixed = steady_clock::now();
+        vector<uint64_t> packed(FixedModel::LA_CHUNKS);
+        int correct = 0;
+        for (size_t i = 0; i < test.size(); i++) {
+            FixedModel::Machine::packInput(test.row(i), packed.data());
+            if (fixed->predict(packed.data()) == test.label(i))
                 correct++;
         }
-        double trainSampleAccuracy = 100.0 * correct / X_train_sampled.size();
-        cout << "Training Sample Accuracy: " << trainSampleAccuracy << " %\n";
+        double fixedTime = duration<double>(steady_clock::now() - startFixed).count();
+        cout << "Fixed-shape model test accuracy: " << 100.0 * correct / test.size() << " % (" << fixedTime << " s)\n";
     }
 
+    // 학습이 끝났으므로 체크포인트는 더 필요 없음 (다음 실행은 처음부터)
+    checkpointer.wait();
+    if (!checkpointer.ok())
+        cerr << "Error writing checkpoint: " << checkpointPath << endl;
+    remove(checkpointPath.c_str());
+    remove(Checkpointer::bestPath(checkpointPath).c_str());
+
     //예시 출력
-    int tmp = rand() % X_test.size();
+    int tmp = rand() % test.size();
     cout << "\n=== Training Completed ===\n";
     cout << "Displaying a random MNIST image from the test set:\n";
-    cout << "True Label: " << y_test[tmp] << "\n";
-    int predictedLabel = mc_tm.predict(X_test[tmp]);
+    cout << "True Label: " << test.label(tmp) << "\n";
+    int predictedLabel = mc_tm.predict(test.row(tmp));
     cout << "Predicted Label: " << predictedLabel << "\n\n";
-    printDigit(X_test[tmp]);
+    printDigit(test.row(tmp));
 
     return 0;
 }
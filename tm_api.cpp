@@ -0,0 +1,122 @@
+// tm_api.cpp
+// C ABI 구현: 핸들은 MultipleClassTsetlin을 감싸고, 입력 포인터를 그대로 pointer 버전 API에 넘김
+#include "tm_api.h"
+#include "MultiClassTsetlin.h"
+#include <new>
+
+static_assert(sizeof(unsigned int) == sizeof(uint32_t), "입력 워드는 32비트 unsigned int여야 함");
+static_assert(sizeof(int) == sizeof(int32_t), "점수는 32비트 int여야 함");
+
+struct tm_model {
+    MultipleClassTsetlin* impl;
+    int words; // 예제 하나의 워드 수 (모든 클래스 machine이 같음)
+};
+
+static tm_model* wrap(MultipleClassTsetlin* impl) {
+    if (impl == nullptr)
+        return nullptr;
+    tm_model* model = new (nothrow) tm_model;
+    if (model == nullptr) {
+        delete impl;
+        return nullptr;
+    }
+    // 절 샤딩은 score/update마다 풀 작업을 할당하므로 핸들은 항상 샤딩 없이 호출 스레드에서 처리
+    impl->setClauseShards(1, nullptr);
+    model->impl = impl;
+    model->words = impl->machine(0).literalWords();
+    return model;
+}
+
+int tm_api_version(void) {
+    return TM_API_VERSION;
+}
+
+// C 호출자에게 예외가 넘어가지 않도록 생성/입출력은 모두 잡아서 NULL/-1로 변환
+tm_model* tm_model_load(const char* path) {
+    if (path == nullptr)
+        return nullptr;
+    try {
+        return wrap(MultipleClassTsetlin::load(string(path)));
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+tm_model* tm_model_create(int num_classes, int clauses, int threshold, double s, int state_bits, int features) {
+    if (num_classes < 2 || clauses < 2 || threshold <= 0 || s < 1.0 || features <= 0)
+        return nullptr;
+    try {
+        return wrap(new MultipleClassTsetlin(num_classes, clauses, threshold, s, state_bits, features));
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+int tm_model_save(const tm_model* model, const char* path) {
+    if (model == nullptr || path == nullptr)
+        return -1;
+    try {
+        return model->impl->save(string(path)) ? 0 : -1;
+    } catch (...) {
+        return -1;
+    }
+}
+
+void tm_model_free(tm_model* model) {
+    if (model == nullptr)
+        return;
+    delete model->impl;
+    delete model;
+}
+
+int tm_num_classes(const tm_model* model) {
+    return model != nullptr ? model->impl->numClasses() : -1;
+}
+
+int tm_input_words(const tm_model* model) {
+    return model != nullptr ? model->words : -1;
+}
+
+// 점수가 필요 없으면 predict의 const 경로, 필요하면 클래스별 const score로 같은 규칙(동점이면 앞 클래스)을 적용.
+// 둘 다 scratch 없이 투표를 바로 세므로 할당이 없고 재진입 가능
+int tm_predict(const tm_model* model, const uint32_t* x, size_t words, int32_t* scores) {
+    if (model == nullptr || x == nullptr || words != (size_t)model->words)
+        return -1;
+    const MultipleClassTsetlin& impl = *model->impl;
+    const unsigned int* Xi = reinterpret_cast<const unsigned int*>(x);
+    if (scores == nullptr)
+        return impl.predict(Xi);
+    int best_class = 0;
+    for (int i = 0; i < impl.numClasses(); i++) {
+        scores[i] = impl.machine(i).score(Xi);
+        if (scores[i] > scores[best_class])
+            best_class = i;
+    }
+    return best_class;
+}
+
+int tm_predict_batch(const tm_model* model, const uint32_t* x, size_t stride, size_t count, int32_t* out) {
+    if (model == nullptr || (count > 0 && (x == nullptr || out == nullptr)) || stride < (size_t)model->words)
+        return -1;
+    const MultipleClassTsetlin& impl = *model->impl;
+    const unsigned int* X = reinterpret_cast<const unsigned int*>(x);
+    // 공용 풀에서 병렬 예측 (predictBatch의 예제 수는 int이므로 나눠서)
+    static const size_t MAX_CHUNK = 1 << 30;
+    try {
+        for (size_t first = 0; first < count; first += MAX_CHUNK) {
+            int chunk = (int)min(MAX_CHUNK, count - first);
+            impl.predictBatch(X + first * stride, stride, chunk, reinterpret_cast<int*>(out + first));
+        }
+    } catch (...) {
+        return -1;
+    }
+    return 0;
+}
+
+int tm_update(tm_model* model, const uint32_t* x, size_t words, int target_class) {
+    if (model == nullptr || x == nullptr || words != (size_t)model->words ||
+        target_class < 0 || target_class >= model->impl->numClasses())
+        return -1;
+    model->impl->train(reinterpret_cast<const unsigned int*>(x), target_class);
+    return 0;
+}
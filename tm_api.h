@@ -0,0 +1,68 @@
+// tm_api.h
+// 다른 언어에서 학습된 모델을 불러와 사용하기 위한 C ABI (libtsetlin.so).
+//
+// 모델은 불투명 핸들(tm_model*)로만 다루며, 입력은 호출자의 버퍼를 복사 없이 그대로 읽음.
+// 입력의 변환 복사가 없고, tm_predict/tm_update는 호출마다 메모리 할당도 없음
+// (핸들은 절 샤딩을 쓰지 않고 호출 스레드에서만 처리. 공용 스레드 풀은 tm_predict_batch만 사용).
+//
+// 입력 형식: 예제 하나는 tm_input_words()개의 uint32 워드 (호스트 바이트 순서).
+//   리터럴 k (0 <= k < 2 * features)는 워드 k / 32의 비트 k % 32. 앞 features개는 특성, 뒤 features개는 그 부정.
+//   마지막 워드의 남는 비트는 무시됨.
+// 정렬: 입력 포인터는 uint32 정렬(4바이트)이면 충분함. 64바이트 정렬이면 행이 캐시 라인에서 시작하여 가장 빠름.
+//
+// 스레드 안전성: tm_predict / tm_predict_batch는 같은 핸들에 대해 여러 스레드에서 동시에 호출 가능.
+//   tm_update는 같은 핸들의 다른 호출과 동시에 호출하면 안 됨.
+//
+// 오류: 정수를 반환하는 함수는 실패 시 음수, 핸들을 반환하는 함수는 NULL을 반환.
+#ifndef TSETLIN_MACHINE_TM_API_H
+#define TSETLIN_MACHINE_TM_API_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TM_API_VERSION 1
+
+// 공유 라이브러리는 -fvisibility=hidden으로 빌드하고 이 함수들만 내보냄
+#if defined(__GNUC__)
+#define TM_API __attribute__((visibility("default")))
+#else
+#define TM_API
+#endif
+
+typedef struct tm_model tm_model;
+
+// 실행 중인 라이브러리의 ABI 버전 (헤더의 TM_API_VERSION과 비교)
+TM_API int tm_api_version(void);
+
+// MultipleClassTsetlin::save로 저장한 모델 파일을 불러옴 (실패 시 NULL)
+TM_API tm_model* tm_model_load(const char* path);
+// 새 모델 생성 (tm_update로 학습할 때). 인자가 잘못되었으면 NULL
+TM_API tm_model* tm_model_create(int num_classes, int clauses, int threshold, double s, int state_bits, int features);
+// 모델 파일로 저장 (성공 0, 실패 -1)
+TM_API int tm_model_save(const tm_model* model, const char* path);
+// 핸들 해제 (NULL이면 아무 일도 하지 않음)
+TM_API void tm_model_free(tm_model* model);
+
+TM_API int tm_num_classes(const tm_model* model);
+// 예제 하나의 워드 수
+TM_API int tm_input_words(const tm_model* model);
+
+// 예제 x (words개의 워드) 하나를 예측하여 클래스를 반환 (실패 시 -1).
+// scores가 NULL이 아니면 tm_num_classes()개의 클래스별 점수를 기록
+TM_API int tm_predict(const tm_model* model, const uint32_t* x, size_t words, int32_t* scores);
+// count개의 예제를 예측. 예제 i는 x + i * stride (워드 단위, stride >= tm_input_words())에서 시작하며
+// 예측 클래스를 out[i]에 기록 (성공 0, 실패 -1).
+// 라이브러리 공용 스레드 풀(TM_THREADS, TM_AFFINITY 환경 변수)에서 예제 구간을 나눠 병렬로 예측
+TM_API int tm_predict_batch(const tm_model* model, const uint32_t* x, size_t stride, size_t count, int32_t* out);
+// 예제 x를 target_class로 온라인 학습 (성공 0, 실패 -1)
+TM_API int tm_update(tm_model* model, const uint32_t* x, size_t words, int target_class);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //TSETLIN_MACHINE_TM_API_H
@@ -0,0 +1,144 @@
+#include "TsetlinMachine.h"
+#include "ReplicaTrainer.h"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <algorithm>
+using namespace std;
+
+// 같은 결과를 내야 하는 학습 경로들을 고정 seed로 나란히 돌려 ta_state가 비트 단위로 같은지 확인.
+// 불일치가 하나라도 있으면 0이 아닌 값으로 종료 (make check / ctest)
+
+static const int FEATURES = 300;   // 리터럴 600개 = 19 청크 (마지막 청크는 일부만 사용)
+static const int CLAUSES = 64;
+static const int THRESHOLD = 15;
+static const double S = 3.9;
+static const int EXAMPLES = 200;
+static const int EPOCHS = 10;
+static const uint64_t SEED = 42;
+
+// 결정적 합성 데이터: 특성은 1/4 확률로 1, target은 앞쪽 특성 몇 개의 논리식
+static void make_data(int literal_words, vector<vector<unsigned int>>& X, vector<int>& y) {
+    uint64_t rng = 12345;
+    for (int i = 0; i < EXAMPLES; i++) {
+        vector<int> x(FEATURES);
+        for (int f = 0; f < FEATURES; f++) {
+            x[f] = TsetlinMachine::nextRandom(rng) % 4 == 0;
+        }
+        int target = (x[0] & x[1]) | (x[2] & !x[3]);
+        // 리터럴 f는 특성 f가 1일 때, 리터럴 FEATURES + f는 특성 f가 0일 때 켜짐
+        vector<unsigned int> Xi(literal_words, 0);
+        for (int f = 0; f < FEATURES; f++) {
+            int la = x[f] ? f : FEATURES + f;
+            Xi[la / 32] |= 1u << (la % 32);
+        }
+        X.push_back(Xi);
+        y.push_back(target);
+    }
+}
+
+// 두 machine의 모든 절, 청크, 비트 평면이 같은지
+static bool same_state(const TsetlinMachine& a, const TsetlinMachine& b) {
+    vector<unsigned int> pa(a.stateBits()), pb(b.stateBits());
+    for (int j = 0; j < a.numClauses(); j++) {
+        for (int k = 0; k < a.literalWords(); k++) {
+            a.getChunk(j, k, pa.data());
+            b.getChunk(j, k, pb.data());
+            if (pa != pb)
+                return false;
+        }
+    }
+    return a.decisionFlips() == b.decisionFlips();
+}
+
+static bool report(const string& name, int state_bits, bool ok) {
+    cout << (ok ? "OK       " : "MISMATCH ") << name << " (state_bits " << state_bits << ")" << endl;
+    return ok;
+}
+
+// fused 커널(기본 scratch) vs 청크별 inc/dec 경로(hogwild scratch, 같은 난수 상태).
+// absorbing이면 양쪽 모두 흡수 상태를 켬: 동결로 학습 궤적 자체가 달라지므로 흡수 상태끼리 비교
+static bool check_fused(int state_bits, bool absorbing, const vector<vector<unsigned int>>& X, const vector<int>& y) {
+    TsetlinMachine a(CLAUSES, THRESHOLD, S, state_bits, FEATURES);
+    TsetlinMachine* b = a.clone();
+    if (absorbing) {
+        // 경계를 결정 경계 가까이 두어 학습 중에 동결이 실제로 일어나게 함
+        int middle = 1 << (state_bits - 1);
+        int lower = max(middle - 4, 0);
+        int upper = min(middle + 3, (1 << state_bits) - 1);
+        a.setAbsorbingState(lower, upper);
+        b->setAbsorbingState(lower, upper);
+    }
+    a.seed(SEED);
+    b->seed(SEED);
+    TsetlinMachine::Scratch scratch = b->createScratch();
+    scratch.hogwild = true;
+    scratch.rng = b->randomState()[0];
+    for (int epoch = 0; epoch < EPOCHS; epoch++) {
+        for (size_t i = 0; i < X.size(); i++) {
+            a.update(X[i], y[i]);
+            b->update(X[i], y[i], scratch);
+        }
+    }
+    bool ok = same_state(a, *b);
+    delete b;
+    return report(absorbing ? "absorbing fused vs per-chunk" : "fused vs per-chunk", state_bits, ok);
+}
+
+// 크기 1 미니배치(accumulate 후 바로 applyAccumulated) vs 온라인 update
+static bool check_mini_batch(int state_bits, const vector<vector<unsigned int>>& X, const vector<int>& y) {
+    TsetlinMachine a(CLAUSES, THRESHOLD, S, state_bits, FEATURES);
+    TsetlinMachine* b = a.clone();
+    a.seed(SEED);
+    b->seed(SEED);
+    for (int epoch = 0; epoch < EPOCHS; epoch++) {
+        for (size_t i = 0; i < X.size(); i++) {
+            a.update(X[i], y[i]);
+            b->accumulate(X[i].data(), y[i]);
+            b->applyAccumulated();
+        }
+    }
+    bool ok = same_state(a, *b);
+    delete b;
+    return report("update vs mini-batch of 1", state_bits, ok);
+}
+
+// 복제본 데이터 병렬 학습: 구간마다 동기화하고, 학습이 끝나면 모든 복제본이 같은 상태
+static bool check_replicas(const vector<vector<unsigned int>>& X, const vector<int>& y) {
+    const int replicas = 3, interval = 20, epochs = 5;
+    ReplicaTrainer trainer(replicas, 2, CLAUSES, THRESHOLD, S, 8, FEATURES, interval);
+    vector<ReplicaTrainer::Report> reports = trainer.fit(X, y, epochs, X, y);
+
+    int shard_size = (X.size() + replicas - 1) / replicas;
+    bool ok = (int)reports.size() == epochs;
+    for (const ReplicaTrainer::Report& report : reports) {
+        ok &= report.syncs == (shard_size + interval - 1) / interval;
+    }
+    int automata = trainer.model().numAutomata();
+    vector<int> first(automata), other(automata);
+    trainer.replica(0).exportStates(first.data());
+    for (int r = 1; r < replicas; r++) {
+        trainer.replica(r).exportStates(other.data());
+        ok &= first == other;
+    }
+    cout << (ok ? "OK       " : "MISMATCH ") << "replicas agree after fit ("
+         << replicas << " replicas, accuracy " << (reports.empty() ? 0.0 : reports.back().accuracy) << ")" << endl;
+    return ok;
+}
+
+int main() {
+    const int state_bits_list[] = {2, 5, 8, 16};
+    vector<vector<unsigned int>> X;
+    vector<int> y;
+    make_data(TsetlinMachine(1, 1, S, 2, FEATURES).literalWords(), X, y);
+
+    bool ok = true;
+    for (int state_bits : state_bits_list) {
+        ok &= check_fused(state_bits, false, X, y);
+        ok &= check_fused(state_bits, true, X, y);
+        ok &= check_mini_batch(state_bits, X, y);
+    }
+    ok &= check_replicas(X, y);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,428 @@
+// tm_server.cpp
+// 학습된 MultipleClassTsetlin 모델을 불러와 UNIX 도메인 소켓(선택적으로 로컬 TCP)으로 예측 요청을 처리하는 서버.
+//
+// 사용법: tm_server <모델 파일> <소켓 경로> [--tcp 포트] [--workers N] [--max-batch B] [--max-delay-us D]
+//                  [--reload-ms T]
+//
+// 모델 파일이 바뀌면(또는 SIGHUP) 백그라운드에서 새 모델을 불러와 무중단으로 교체 (ModelHandle)
+//
+// 프로토콜 (호스트 바이트 순서, 한 연결에서 여러 요청을 연속으로 보낼 수 있음):
+//   요청: uint32 words, 이어서 words개의 uint32 (packExample과 같은 리터럴+부정 리터럴 패킹).
+//         words는 모델의 literalWords()와 같아야 하며, 다르면 연결을 닫음
+//   응답: int32 class, uint32 num_classes, 이어서 num_classes개의 int32 점수
+//
+// 수신: 연결은 non-blocking이며 연결마다 받은 바이트를 버퍼에 모아 완성된 요청만 큐에 넣음
+// (느리거나 요청을 나눠 보내는 클라이언트가 다른 연결을 막지 않음)
+//
+// 마이크로 배치: 작업자는 다음 조건 중 하나가 되면 큐에 쌓인 요청을 내보내고, 쉬는 작업자끼리 나눠 가짐 (각자 최대 B개)
+//   - 큐에 B개 이상 쌓임
+//   - 가장 오래된 요청이 D 마이크로초 이상 기다림 (p99 지연 상한)
+//   - 처리 중인 배치가 하나도 없음 (부하가 낮으면 기다리지 않고 바로 처리)
+// 꺼낸 배치는 연속 버퍼에 모아 predictBatch로 한 번에 점수를 매김
+#include "MultiClassTsetlin.h"
+#include "ModelHandle.h"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <csignal>
+#include <cerrno>
+#include <cstring>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <map>
+
+using namespace std;
+using namespace std::chrono;
+
+// 클라이언트 연결: 마지막 참조(수신 스레드 또는 처리 중인 요청)가 사라질 때 소켓을 닫음
+struct Connection {
+    int fd;
+    vector<char> input;      // 수신 스레드 전용: 아직 완성되지 않은 요청 바이트
+    unsigned long long received = 0; // 수신 스레드 전용: 지금까지 받은 요청 수 (요청 순번)
+    mutex write_mtx;         // 여러 작업자가 같은 연결에 응답할 때 메시지가 섞이지 않도록 보호
+    condition_variable turn; // 응답 순서 대기
+    unsigned long long replied = 0; // 응답을 마친(또는 건너뛴) 요청 수 (write_mtx로 보호)
+    explicit Connection(int fd) : fd(fd) {}
+    ~Connection() { close(fd); }
+    // 잘못된 요청이나 응답 실패: 수신 스레드가 다음 poll에서 연결을 정리하도록 양방향을 닫음
+    void abort() { shutdown(fd, SHUT_RDWR); }
+};
+
+struct Request {
+    shared_ptr<Connection> conn;
+    unsigned long long seq; // 연결 안에서의 순번: 여러 작업자가 나눠 처리해도 요청 순서대로 응답
+    vector<unsigned int> Xi;
+    steady_clock::time_point arrival;
+};
+
+static bool write_all(int fd, const void* data, size_t bytes);
+
+// seq번 요청 차례가 될 때까지 기다렸다가 응답을 씀 (reply가 nullptr이면 차례만 넘김).
+// 큐에서 앞쪽을 먼저 꺼내므로 앞선 순번은 이미 다른 작업자가 가져갔고, 기다림이 순환하지 않음
+static void reply_in_order(Request& request, const int* reply, size_t count) {
+    Connection& conn = *request.conn;
+    unique_lock<mutex> lock(conn.write_mtx);
+    conn.turn.wait(lock, [&]() { return conn.replied == request.seq; });
+    if (reply != nullptr && !write_all(conn.fd, reply, count * sizeof(int)))
+        conn.abort();
+    conn.replied++;
+    conn.turn.notify_all();
+}
+
+static atomic<bool> running(true);
+static atomic<bool> hangup(false);
+
+static void handle_signal(int) {
+    running = false;
+}
+
+static void handle_hangup(int) {
+    hangup = true;
+}
+
+static const int WRITE_TIMEOUT_MS = 1000; // 응답을 받지 않는 클라이언트를 끊기까지 기다리는 시간
+
+// non-blocking 연결에 모두 씀: 송신 버퍼가 차면 WRITE_TIMEOUT_MS까지 쓸 수 있게 되기를 기다림
+static bool write_all(int fd, const void* data, size_t bytes) {
+    const char* p = static_cast<const char*>(data);
+    while (bytes > 0) {
+        ssize_t n = send(fd, p, bytes, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            pollfd writable = {fd, POLLOUT, 0};
+            if (poll(&writable, 1, WRITE_TIMEOUT_MS) <= 0)
+                return false;
+            continue;
+        }
+        if (n <= 0)
+            return false;
+        p += n;
+        bytes -= n;
+    }
+    return true;
+}
+
+// 읽을 수 있는 만큼 읽어 연결 버퍼에 붙이고, 완성된 요청을 out에 추가.
+// 연결이 끝났거나 words가 모델과 다르면 false (연결을 닫아야 함)
+static bool receive(const shared_ptr<Connection>& conn, unsigned int words, vector<Request>& out) {
+    char buffer[65536];
+    bool open = true;
+    while (true) {
+        ssize_t n = read(conn->fd, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        if (n <= 0) {
+            open = false;
+            break;
+        }
+        conn->input.insert(conn->input.end(), buffer, buffer + n);
+    }
+
+    vector<char>& input = conn->input;
+    size_t message = sizeof(unsigned int) + (size_t)words * sizeof(unsigned int);
+    size_t pos = 0;
+    while (input.size() - pos >= sizeof(unsigned int)) {
+        unsigned int header;
+        memcpy(&header, input.data() + pos, sizeof(header));
+        if (header != words)
+            return false;
+        if (input.size() - pos < message)
+            break;
+        Request request;
+        request.conn = conn;
+        request.seq = conn->received++;
+        request.Xi.resize(words);
+        memcpy(request.Xi.data(), input.data() + pos + sizeof(header), (size_t)words * sizeof(unsigned int));
+        request.arrival = steady_clock::now();
+        out.push_back(std::move(request));
+        pos += message;
+    }
+    input.erase(input.begin(), input.begin() + pos);
+    return open;
+}
+
+class BatchQueue {
+public:
+    BatchQueue(int max_batch, int max_delay_us, int num_workers)
+            : max_batch(max_batch), max_delay(max_delay_us), num_workers(num_workers), busy(0), released(0) {}
+
+    void push(vector<Request>& requests) {
+        if (requests.empty())
+            return;
+        {
+            lock_guard<mutex> lock(mtx);
+            for (auto& request : requests) {
+                queue.push_back(std::move(request));
+            }
+        }
+        requests.clear();
+        ready.notify_one();
+    }
+
+    // 배치 조건이 충족될 때까지 기다렸다가 요청을 꺼냄 (종료 시 빈 배치).
+    // 조건이 충족된 시점에 쌓인 요청은 쉬는 작업자 수로 나눠 각자 최대 max_batch개씩 가져감
+    void pop_batch(vector<Request>& batch) {
+        batch.clear();
+        unique_lock<mutex> lock(mtx);
+        while (running) {
+            if (released > 0)
+                break;
+            if (!queue.empty()) {
+                bool full = (int)queue.size() >= max_batch;
+                bool idle = busy == 0;
+                auto deadline = queue.front().arrival + max_delay;
+                if (full || idle || steady_clock::now() >= deadline) {
+                    released = (int)queue.size();
+                    break;
+                }
+                ready.wait_until(lock, deadline);
+            } else {
+                ready.wait_for(lock, milliseconds(100));
+            }
+        }
+        int idle_workers = max(1, num_workers - busy);
+        int share = min(max_batch, (released + idle_workers - 1) / idle_workers);
+        while (!queue.empty() && (int)batch.size() < max(share, 1)) {
+            batch.push_back(std::move(queue.front()));
+            queue.pop_front();
+        }
+        released = max(0, released - (int)batch.size());
+        if (!batch.empty())
+            busy++;
+        // 남은 몫은 다른 쉬는 작업자가 바로 가져감
+        if (released > 0)
+            ready.notify_one();
+    }
+
+    void done() {
+        {
+            lock_guard<mutex> lock(mtx);
+            busy--;
+        }
+        ready.notify_one();
+    }
+
+    void wake_all() { ready.notify_all(); }
+
+private:
+    int max_batch;
+    microseconds max_delay;
+    int num_workers;
+    int busy;     // 처리 중인 배치 수
+    int released; // 조건이 충족되어 기다리지 않고 나눠 가질 요청 수 (큐 앞쪽)
+    mutex mtx;
+    condition_variable ready;
+    deque<Request> queue;
+};
+
+static int listen_unix(const string& path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    unlink(path.c_str());
+    if (fd < 0 || bind(fd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 128) != 0) {
+        perror("UNIX socket");
+        exit(EXIT_FAILURE);
+    }
+    return fd;
+}
+
+static int listen_tcp(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // 로컬 전용
+    if (fd < 0 || bind(fd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 128) != 0) {
+        perror("TCP socket");
+        exit(EXIT_FAILURE);
+    }
+    return fd;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        cerr << "Usage: " << argv[0]
+             << " <model> <socket path> [--tcp port] [--workers N] [--max-batch B] [--max-delay-us D]"
+             << " [--reload-ms T]\n";
+        return EXIT_FAILURE;
+    }
+    string model_path = argv[1];
+    string socket_path = argv[2];
+    int tcp_port = 0;
+    int num_workers = max(1u, thread::hardware_concurrency());
+    int max_batch = 32;
+    int max_delay_us = 500;
+    int reload_ms = 1000;
+    for (int i = 3; i + 1 < argc; i += 2) {
+        string option = argv[i];
+        int value = atoi(argv[i + 1]);
+        if (option == "--tcp") tcp_port = value;
+        else if (option == "--workers") num_workers = max(1, value);
+        else if (option == "--max-batch") max_batch = max(1, value);
+        else if (option == "--max-delay-us") max_delay_us = max(0, value);
+        else if (option == "--reload-ms") reload_ms = max(10, value);
+        else {
+            cerr << "Unknown option: " << option << "\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    MultipleClassTsetlin* model = MultipleClassTsetlin::load(model_path);
+    if (model == nullptr) {
+        cerr << "Error loading model: " << model_path << endl;
+        return EXIT_FAILURE;
+    }
+    int initial_classes = model->numClasses();
+    TsetlinMachine::Scratch initial_scratch = model->createScratch();
+    // 작업자마다 하나, 요청 크기를 확인하는 수신 스레드에 하나
+    ModelHandle handle(model, num_workers + 1);
+    handle.watch(model_path, reload_ms, [](const string& path, bool reloaded) {
+        if (reloaded)
+            cout << "Model reloaded: " << path << endl;
+        else
+            cerr << "Model reload failed: " << path << endl;
+    });
+
+    signal(SIGINT, handle_signal);
+    signal(SIGTERM, handle_signal);
+    signal(SIGHUP, handle_hangup);
+
+    vector<int> listeners;
+    listeners.push_back(listen_unix(socket_path));
+    if (tcp_port > 0)
+        listeners.push_back(listen_tcp(tcp_port));
+    cout << "Serving " << model_path << " (" << initial_classes << " classes) on " << socket_path;
+    if (tcp_port > 0)
+        cout << " and 127.0.0.1:" << tcp_port;
+    cout << " with " << num_workers << " workers, batch <= " << max_batch
+         << ", delay <= " << max_delay_us << " us" << endl;
+
+    BatchQueue queue(max_batch, max_delay_us, num_workers);
+    atomic<long long> served(0), batches(0);
+
+    // 작업자: 배치를 꺼내 연속 버퍼에 모은 뒤 스레드별 scratch로 한 번에 예측하고 각 연결에 응답.
+    // 배치마다 읽기 구간에 들어가므로, 교체된 이전 모델은 진행 중인 배치가 끝나는 즉시 회수됨
+    vector<thread> workers;
+    for (int w = 0; w < num_workers; w++) {
+        workers.emplace_back([&]() {
+            int reader = handle.registerReader();
+            // 새 모델의 크기가 달라도 scoreBatch가 scratch를 필요한 만큼 늘려 사용
+            TsetlinMachine::Scratch scratch = initial_scratch;
+            vector<unsigned int> packed;
+            vector<int> classes, scores, reply;
+            vector<Request*> valid;
+            vector<Request> batch;
+            while (true) {
+                queue.pop_batch(batch);
+                if (batch.empty())
+                    break;
+                int num_classes;
+                {
+                    ModelHandle::ReadGuard current = handle.read(reader);
+                    num_classes = current->numClasses();
+                    size_t words = current->machine(0).literalWords();
+                    // 수신 후 모델이 교체되어 크기가 달라진 요청은 연결을 닫음
+                    packed.clear();
+                    valid.clear();
+                    for (auto& request : batch) {
+                        if (request.Xi.size() != words) {
+                            request.conn->abort();
+                            reply_in_order(request, nullptr, 0);
+                            continue;
+                        }
+                        packed.insert(packed.end(), request.Xi.begin(), request.Xi.end());
+                        valid.push_back(&request);
+                    }
+                    int count = (int)valid.size();
+                    classes.resize(count);
+                    scores.resize((size_t)count * num_classes);
+                    current->predictBatch(packed.data(), words, count, classes.data(), scratch, scores.data());
+                }
+                reply.resize(2 + num_classes);
+                for (size_t e = 0; e < valid.size(); e++) {
+                    reply[0] = classes[e];
+                    reply[1] = num_classes;
+                    copy(scores.begin() + e * num_classes, scores.begin() + (e + 1) * num_classes, reply.begin() + 2);
+                    reply_in_order(*valid[e], reply.data(), reply.size());
+                }
+                served += valid.size();
+                batches++;
+                batch.clear();
+                queue.done();
+            }
+        });
+    }
+
+    // 수신 루프: 새 연결을 받고, 읽을 수 있는 연결에서 받은 만큼 읽어 완성된 요청을 큐에 넣음
+    int receiver = handle.registerReader();
+    map<int, shared_ptr<Connection>> connections;
+    vector<pollfd> fds;
+    vector<Request> received;
+    while (running) {
+        if (hangup.exchange(false))
+            handle.requestReload();
+        fds.clear();
+        for (int fd : listeners) {
+            fds.push_back({fd, POLLIN, 0});
+        }
+        for (auto& entry : connections) {
+            fds.push_back({entry.first, POLLIN, 0});
+        }
+        int ready = poll(fds.data(), fds.size(), 200);
+        if (ready <= 0)
+            continue;
+        unsigned int words;
+        {
+            ModelHandle::ReadGuard current = handle.read(receiver);
+            words = current->machine(0).literalWords();
+        }
+        for (size_t i = 0; i < fds.size(); i++) {
+            if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR)))
+                continue;
+            if (i < listeners.size()) {
+                int client = accept(fds[i].fd, nullptr, nullptr);
+                if (client >= 0) {
+                    fcntl(client, F_SETFL, fcntl(client, F_GETFL) | O_NONBLOCK);
+                    connections[client] = make_shared<Connection>(client);
+                }
+                continue;
+            }
+            int fd = fds[i].fd;
+            bool open = receive(connections[fd], words, received);
+            queue.push(received);
+            if (!open)
+                connections.erase(fd); // 처리 중인 요청이 있으면 그 요청이 끝난 뒤 닫힘
+        }
+    }
+
+    queue.wake_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    connections.clear();
+    for (int fd : listeners) {
+        close(fd);
+    }
+    unlink(socket_path.c_str());
+    cout << "Served " << served << " requests in " << batches << " batches, "
+         << handle.reloads() << " model reloads (" << handle.reloadFailures() << " failed)" << endl;
+    return 0;
+}